@@ -0,0 +1,130 @@
+/*
+ * Small batch benchmark for the multi-block engines on a host machine.
+ *
+ * For every batch size it measures one call that encrypts n blocks under a fresh
+ * key, so the key setup of the engine is part of every call, and prints the time
+ * per block and per call. The time per call at n = PRESENT_IL_WAYS is the latency
+ * of one group, the time per block at 4096 blocks the throughput.
+ *
+ * Every engine defines crypto_func, so one build links exactly one engine, chosen
+ * with BENCH_IL, BENCH_AVX2, BENCH_BS or BENCH_REF. Build with the crypto.h of the
+ * host, e.g.
+ *   cc -O2 -DBENCH_IL -DPRESENT_IL_WAYS=4 -I../present_il -I../present_bs -I<crypto.h dir> engines.c ../present_il/crypto.c -o engines_il
+ *   cc -O2 -mavx2 -DBENCH_AVX2 -I../present_avx2 -I../present_bs -I<crypto.h dir> engines.c ../present_avx2/crypto.c -o engines_avx2
+ *   cc -O2 -DBENCH_BS -I../present_bs -I<crypto.h dir> engines.c ../present_bs/crypto.c -o engines_bs
+ *   cc -O2 -DBENCH_REF -I<crypto.h dir> engines.c ../present_ref/crypto.c -o engines_ref
+ * Usage: engines [-T seconds per point]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "crypto.h"
+
+#if defined(BENCH_IL)
+#include "present_il.h"
+#define ENGINE_NAME "present_il"
+#elif defined(BENCH_AVX2)
+#include "present_avx2.h"
+#define ENGINE_NAME "present_avx2"
+#elif defined(BENCH_BS)
+#include "present_bs.h"
+#define ENGINE_NAME "present_bs"
+#elif defined(BENCH_REF)
+#define ENGINE_NAME "present_ref"
+void crypto_func(uint8_t pt[CRYPTO_IN_SIZE], uint8_t key[CRYPTO_KEY_SIZE]);
+#else
+#error "select an engine with BENCH_IL, BENCH_AVX2, BENCH_BS or BENCH_REF"
+#endif
+
+#define MAX_BLOCKS 4096
+
+static const size_t sizes[] = { 1, 2, 4, 8, 16, 32, 64, MAX_BLOCKS };
+
+static double now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// encrypt runs one call of the selected engine on n blocks, key setup included
+static void encrypt(uint8_t *blocks, size_t n, const uint8_t key[CRYPTO_KEY_SIZE])
+{
+#if defined(BENCH_IL)
+	present_il_encrypt(blocks, n, key);
+#elif defined(BENCH_AVX2)
+	present_avx2_encrypt(blocks, n, key);
+#elif defined(BENCH_BS)
+	present_bs_key_t ks;
+
+	present_bs_expand_key(&ks, key);
+	present_bs_encrypt_blocks(&ks, blocks, n);
+#elif defined(BENCH_REF)
+	for (size_t i = 0; i < n; i++)
+	{
+		uint8_t k[CRYPTO_KEY_SIZE];
+
+		memcpy(k, key, CRYPTO_KEY_SIZE);
+		crypto_func(blocks + i * CRYPTO_IN_SIZE, k);
+	}
+#endif
+}
+
+// measure repeats calls on n blocks until min_time is reached and returns seconds per call
+static double measure(uint8_t *buf, size_t n, uint8_t key[CRYPTO_KEY_SIZE], double min_time)
+{
+	size_t calls = 0;
+	double start = now();
+	double t;
+
+	encrypt(buf, n, key); // warm up caches and tables
+
+	do
+	{
+		// a new key for every call, so no schedule can be reused
+		key[calls % CRYPTO_KEY_SIZE]++;
+		encrypt(buf, n, key);
+		calls++;
+		t = now() - start;
+	} while (t < min_time);
+
+	return t / calls;
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t buf[MAX_BLOCKS * CRYPTO_IN_SIZE];
+	uint8_t key[CRYPTO_KEY_SIZE] = { 0 };
+	double min_time = 0.2;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "T:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'T':
+			min_time = atof(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-T seconds]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	memset(buf, 0x5A, sizeof(buf));
+
+	printf("%s\n%8s %12s %12s\n", ENGINE_NAME, "blocks", "ns/block", "ns/call");
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		double call = measure(buf, sizes[i], key, min_time);
+
+		printf("%8zu %12.1f %12.1f\n", sizes[i], call * 1e9 / sizes[i], call * 1e9);
+	}
+
+	return 0;
+}
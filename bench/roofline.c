@@ -0,0 +1,251 @@
+/*
+ * Roofline benchmark for the bulk modes of present_bs on a host machine.
+ *
+ * For every working set size (L1 up to far past the LLC) and thread count it
+ * measures
+ *   - stream: an in-place XOR pass over the buffer, the memory bandwidth that an
+ *     in-place cipher pass could reach at best,
+ *   - ecb and ctr: present_bs_encrypt_blocks and present_bs_ctr_xor over the buffer,
+ * and compares the cipher with the two ceilings of the roofline: the stream
+ * bandwidth at that size, and the compute peak, which is the cipher throughput on
+ * a 16 KB buffer per thread that never leaves L1. A configuration is memory-bound
+ * when the bandwidth ceiling is the lower one and the cipher gets close to it.
+ *
+ * All rates are bytes of buffer processed per second, every thread works on its
+ * own slice of the working set.
+ *
+ * Build with the crypto.h of the host, e.g.
+ *   cc -O2 -pthread -I../present_bs -I<crypto.h dir> roofline.c ../present_bs/crypto.c -o roofline
+ * Usage: roofline [-t max threads] [-s max working set in MB] [-T seconds per point]
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "present_bs.h"
+
+#define MAX_THREADS 1024
+#define MAX_SIZE_MB (64 * 1024)
+#define PEAK_SIZE (16 << 10) // per thread buffer of the compute ceiling, stays in L1
+
+enum kernel
+{
+	KERNEL_STREAM,
+	KERNEL_ECB,
+	KERNEL_CTR,
+};
+
+static const char *kernel_name[] = { "stream", "ecb", "ctr" };
+
+typedef struct
+{
+	pthread_t thread;
+	pthread_barrier_t *barrier;
+	const present_bs_key_t *ks;
+	enum kernel kernel;
+	uint8_t *buf;
+	size_t len;
+	double min_time;
+	double rate;
+} worker_t;
+
+static double now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// run_pass processes the slice of one worker once with the selected kernel
+static void run_pass(worker_t *w)
+{
+	switch (w->kernel)
+	{
+	case KERNEL_STREAM:
+	{
+		uint64_t *p = (uint64_t *)w->buf;
+
+		for (size_t i = 0; i < w->len / sizeof(uint64_t); i++)
+		{
+			p[i] ^= 0x9E3779B97F4A7C15ull;
+		}
+		break;
+	}
+	case KERNEL_ECB:
+		present_bs_encrypt_blocks(w->ks, w->buf, w->len / CRYPTO_IN_SIZE);
+		break;
+	case KERNEL_CTR:
+		present_bs_ctr_xor(w->ks, 0, w->buf, w->buf, w->len);
+		break;
+	}
+}
+
+// worker repeats passes until min_time is reached, after all threads have started
+static void *worker(void *arg)
+{
+	worker_t *w = arg;
+	size_t passes = 0;
+
+	run_pass(w); // warm up caches and pages
+	pthread_barrier_wait(w->barrier);
+
+	double start = now();
+	double t;
+
+	do
+	{
+		run_pass(w);
+		passes++;
+		t = now() - start;
+	} while (t < w->min_time);
+
+	w->rate = (double)w->len * passes / t;
+
+	return 0;
+}
+
+/*
+ * measure runs kernel on threads workers, each on size / threads bytes, and returns
+ * the combined rate in bytes per second.
+ */
+static double measure(enum kernel kernel, const present_bs_key_t *ks, uint8_t *buf, size_t size,
+	unsigned threads, double min_time)
+{
+	worker_t w[threads];
+	pthread_barrier_t barrier;
+	size_t slice = size / threads / PRESENT_BS_BATCH_SIZE * PRESENT_BS_BATCH_SIZE;
+	double rate = 0;
+
+	pthread_barrier_init(&barrier, 0, threads);
+
+	for (unsigned i = 0; i < threads; i++)
+	{
+		w[i].barrier = &barrier;
+		w[i].ks = ks;
+		w[i].kernel = kernel;
+		w[i].buf = buf + i * slice;
+		w[i].len = slice;
+		w[i].min_time = min_time;
+		pthread_create(&w[i].thread, 0, worker, &w[i]);
+	}
+
+	for (unsigned i = 0; i < threads; i++)
+	{
+		pthread_join(w[i].thread, 0);
+		rate += w[i].rate;
+	}
+
+	pthread_barrier_destroy(&barrier);
+
+	return rate;
+}
+
+// parse_range parses a decimal number in min ... max, returns -1 for anything else
+static int parse_range(const char *arg, unsigned long min, unsigned long max, unsigned long *out)
+{
+	char *end;
+
+	if (*arg < '0' || *arg > '9')
+	{
+		return -1; // strtoul would accept a sign or leading space
+	}
+
+	errno = 0;
+	*out = strtoul(arg, &end, 10);
+
+	return errno || *end || *out < min || *out > max ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned max_threads = cpus < 1 ? 1 : cpus > MAX_THREADS ? MAX_THREADS : (unsigned)cpus;
+	size_t max_size = (size_t)64 << 20;
+	double min_time = 0.2;
+	const uint8_t key[CRYPTO_KEY_SIZE] = { 0 };
+	present_bs_key_t ks;
+	unsigned long n;
+	int bad = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:s:T:")) != -1)
+	{
+		switch (opt)
+		{
+		case 't':
+			bad |= parse_range(optarg, 1, MAX_THREADS, &n);
+			max_threads = (unsigned)n;
+			break;
+		case 's':
+			bad |= parse_range(optarg, 1, MAX_SIZE_MB, &n);
+			max_size = (size_t)n << 20;
+			break;
+		case 'T':
+			min_time = atof(optarg);
+			break;
+		default:
+			bad = 1;
+			break;
+		}
+	}
+
+	if (bad)
+	{
+		fprintf(stderr, "usage: %s [-t threads] [-s MB] [-T seconds]\n", argv[0]);
+		return 1;
+	}
+
+	present_bs_expand_key(&ks, key);
+
+	// large enough for the biggest working set and for the compute ceiling of every thread
+	size_t alloc = (size_t)max_threads * PEAK_SIZE > max_size ? (size_t)max_threads * PEAK_SIZE : max_size;
+	uint8_t *buf = aligned_alloc(4096, alloc);
+	if (!buf)
+	{
+		fprintf(stderr, "cannot allocate %zu bytes\n", alloc);
+		return 1;
+	}
+	memset(buf, 0x5A, alloc);
+
+	printf("%10s %7s %6s %10s %10s %10s %6s %s\n", "size", "threads", "mode", "GB/s", "stream", "compute", "util",
+		"bound");
+
+	for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+	{
+		// compute ceiling: every thread on its own buffer that stays in L1
+		double peak[3];
+		for (int k = KERNEL_ECB; k <= KERNEL_CTR; k++)
+		{
+			peak[k] = measure((enum kernel)k, &ks, buf, (size_t)threads * PEAK_SIZE, threads, min_time);
+		}
+
+		for (size_t size = (size_t)16 << 10; size <= max_size; size *= 4)
+		{
+			if (size / threads < PRESENT_BS_BATCH_SIZE)
+			{
+				continue;
+			}
+
+			double stream = measure(KERNEL_STREAM, &ks, buf, size, threads, min_time);
+
+			for (int k = KERNEL_ECB; k <= KERNEL_CTR; k++)
+			{
+				double rate = measure((enum kernel)k, &ks, buf, size, threads, min_time);
+				double roof = stream < peak[k] ? stream : peak[k];
+
+				printf("%9zuK %7u %6s %10.3f %10.3f %10.3f %5.0f%% %s\n", size >> 10, threads, kernel_name[k],
+					rate / 1e9, stream / 1e9, peak[k] / 1e9, 100 * rate / roof,
+					stream < peak[k] ? "memory" : "compute");
+			}
+		}
+	}
+
+	free(buf);
+
+	return 0;
+}
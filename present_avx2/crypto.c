@@ -0,0 +1,127 @@
+#include "crypto.h"
+#include "present_avx2.h"
+#include "engine.h"
+#include "util.h"
+
+#if !defined(__AVX2__)
+#error "present_avx2 needs AVX2 (vpgatherqq)"
+#endif
+
+#include <immintrin.h>
+
+/*
+ * Table engine with vector gathers for x86 hosts. Like present_il, a round is the
+ * XOR of eight lookups into combined SBox/permutation tables, but every lookup is
+ * one gather that serves 4 blocks (AVX2) or 8 blocks (AVX-512) at once. Blocks are
+ * loaded straight into the vector lanes, a block in normal form being the little
+ * endian 64-bit integer.
+ */
+#if defined(__AVX512F__)
+typedef __m512i vec_t;
+#define VEC_BLOCKS 8
+#define vec_load(p) _mm512_loadu_si512((const void *)(p))
+#define vec_store(p, v) _mm512_storeu_si512((void *)(p), v)
+#define vec_set1 _mm512_set1_epi64
+#define vec_xor _mm512_xor_si512
+#define vec_and _mm512_and_si512
+#define vec_srli _mm512_srli_epi64
+#define vec_gather(t, i) _mm512_i64gather_epi64(i, (const void *)(t), 8)
+#else
+typedef __m256i vec_t;
+#define VEC_BLOCKS 4
+#define vec_load(p) _mm256_loadu_si256((const __m256i *)(p))
+#define vec_store(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#define vec_set1(x) _mm256_set1_epi64x((long long)(x))
+#define vec_xor _mm256_xor_si256
+#define vec_and _mm256_and_si256
+#define vec_srli _mm256_srli_epi64
+#define vec_gather(t, i) _mm256_i64gather_epi64((const long long *)(t), i, 8)
+#endif
+
+/*
+ * sp holds the combined SBox and permutation tables, see sp_init. They are built
+ * by a constructor before main, so every caller only ever reads them.
+ */
+static uint64_t sp[8][256];
+
+__attribute__((constructor)) static void init_tables(void)
+{
+	sp_init(sp);
+}
+
+/*
+ * encrypt_vec runs all rounds on VEC_BLOCKS blocks. The byte indices of every
+ * lane are cut out with a shift and a mask, and the eight gathers of a round are
+ * independent of each other, so they can be in flight at the same time.
+ */
+static vec_t encrypt_vec(vec_t s, const vec_t rk[32])
+{
+	const vec_t low = vec_set1(0xFF);
+
+	for (uint8_t r = 0; r < 31; r++)
+	{
+		s = vec_xor(s, rk[r]);
+
+		vec_t t = vec_gather(sp[0], vec_and(s, low));
+		for (uint8_t k = 1; k < 8; k++)
+		{
+			t = vec_xor(t, vec_gather(sp[k], vec_and(vec_srli(s, k * 8), low)));
+		}
+
+		s = t;
+	}
+
+	return vec_xor(s, rk[31]);
+}
+
+/**
+ * Encrypt n blocks under one expanded key schedule
+ * @param blocks Input: plaintext blocks, Output: ciphertext blocks
+ * @param n Number of blocks, a last vector that is not full is staged and padded
+ * @param key Cipher key, left untouched
+ */
+void present_avx2_encrypt(uint8_t *blocks, size_t n, const uint8_t key[CRYPTO_KEY_SIZE])
+{
+	vec_t rk[32];
+	uint8_t k[CRYPTO_KEY_SIZE];
+	uint8_t i;
+
+	for (i = 0; i < CRYPTO_KEY_SIZE; i++)
+	{
+		k[i] = key[i];
+	}
+
+	for (i = 0; i < 32; i++)
+	{
+		rk[i] = vec_set1(get64(k + 2));
+		update_round_key(k, i + 1);
+	}
+
+	for (; n >= VEC_BLOCKS; n -= VEC_BLOCKS, blocks += VEC_BLOCKS * CRYPTO_IN_SIZE)
+	{
+		vec_store(blocks, encrypt_vec(vec_load(blocks), rk));
+	}
+
+	if (n)
+	{
+		uint8_t tail[VEC_BLOCKS * CRYPTO_IN_SIZE] = { 0 };
+		size_t len = n * CRYPTO_IN_SIZE;
+
+		for (size_t b = 0; b < len; b++)
+		{
+			tail[b] = blocks[b];
+		}
+
+		vec_store(tail, encrypt_vec(vec_load(tail), rk));
+
+		for (size_t b = 0; b < len; b++)
+		{
+			blocks[b] = tail[b];
+		}
+	}
+}
+
+void crypto_func(uint8_t pt[CRYPTO_IN_SIZE], uint8_t key[CRYPTO_KEY_SIZE])
+{
+	present_avx2_encrypt(pt, 1, key);
+}
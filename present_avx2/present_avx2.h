@@ -0,0 +1,9 @@
+#ifndef PRESENT_AVX2_H
+#define PRESENT_AVX2_H
+
+#include <stddef.h>
+#include "crypto.h"
+
+void present_avx2_encrypt(uint8_t *blocks, size_t n, const uint8_t key[CRYPTO_KEY_SIZE]);
+
+#endif
@@ -0,0 +1,212 @@
+#include "aead.h"
+#include "util.h"
+
+#if defined(__PCLMUL__)
+#include <wmmintrin.h>
+#endif
+
+#if defined(__PCLMUL__)
+/*
+ * gf64_mul multiplies two elements of GF(2^64) modulo x^64 + x^4 + x^3 + x + 1
+ * with the carry-less multiply instruction. The upper half of the 128-bit product
+ * is folded back twice, as x^64 = x^4 + x^3 + x + 1 and the first fold can
+ * overflow by up to 4 bits.
+ */
+static uint64_t gf64_mul(uint64_t a, uint64_t b)
+{
+	const __m128i poly = _mm_cvtsi64_si128(0x1B);
+	__m128i p = _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)a), _mm_cvtsi64_si128((long long)b), 0x00);
+	__m128i f = _mm_clmulepi64_si128(p, poly, 0x01);
+	__m128i g = _mm_clmulepi64_si128(f, poly, 0x01);
+
+	return (uint64_t)_mm_cvtsi128_si64(_mm_xor_si128(_mm_xor_si128(p, f), g));
+}
+#else
+/*
+ * gf64_mul multiplies two elements of GF(2^64) modulo x^64 + x^4 + x^3 + x + 1.
+ * This is the portable shift and add version: for every bit of b, a is added when
+ * the bit is set and then doubled. Both steps use masks instead of branches, so
+ * the time taken does not depend on the hash key or the data.
+ */
+static uint64_t gf64_mul(uint64_t a, uint64_t b)
+{
+	uint64_t r = 0;
+
+	for (uint8_t i = 0; i < 64; i++)
+	{
+		r ^= a & (0 - ((b >> i) & 1));
+		a = (a << 1) ^ ((0 - (a >> 63)) & 0x1B);
+	}
+
+	return r;
+}
+#endif
+
+/*
+ * hash_absorb feeds bytes into the polynomial hash x = (x ^ block) * h. Bytes that
+ * do not fill a whole block are kept in partial until the next call.
+ */
+static void hash_absorb(present_bs_aead_t *ctx, const uint8_t *data, size_t len)
+{
+	while (len && ctx->partial_len)
+	{
+		ctx->partial[ctx->partial_len++] = *data++;
+		len--;
+
+		if (ctx->partial_len == CRYPTO_IN_SIZE)
+		{
+			ctx->x = gf64_mul(ctx->x ^ get64(ctx->partial), ctx->h);
+			ctx->partial_len = 0;
+		}
+	}
+
+	for (; len >= CRYPTO_IN_SIZE; data += CRYPTO_IN_SIZE, len -= CRYPTO_IN_SIZE)
+	{
+		ctx->x = gf64_mul(ctx->x ^ get64(data), ctx->h);
+	}
+
+	while (len--)
+	{
+		ctx->partial[ctx->partial_len++] = *data++;
+	}
+}
+
+// hash_pad zero pads the last partial block of the associated data or the message
+static void hash_pad(present_bs_aead_t *ctx)
+{
+	if (ctx->partial_len)
+	{
+		while (ctx->partial_len < CRYPTO_IN_SIZE)
+		{
+			ctx->partial[ctx->partial_len++] = 0;
+		}
+
+		ctx->x = gf64_mul(ctx->x ^ get64(ctx->partial), ctx->h);
+		ctx->partial_len = 0;
+	}
+}
+
+/*
+ * present_bs_aead_init derives the hash key h = E(0) and the tag mask E(nonce || 1)
+ * from a single bitsliced batch; the remaining lanes are left unused.
+ */
+void present_bs_aead_init(present_bs_aead_t *ctx, const present_bs_key_t *ks, uint32_t nonce)
+{
+	uint8_t batch[PRESENT_BS_BATCH_SIZE] = { 0 };
+
+	put64(batch + CRYPTO_IN_SIZE, ((uint64_t)nonce << 32) | 1);
+	present_bs_encrypt_batch(batch, ks);
+
+	ctx->ks = ks;
+	ctx->h = get64(batch);
+	ctx->mask = get64(batch + CRYPTO_IN_SIZE);
+	ctx->x = 0;
+	ctx->ctr = PRESENT_BS_AEAD_CTR(nonce, 0);
+	ctx->aad_len = 0;
+	ctx->msg_len = 0;
+	ctx->stream_pos = PRESENT_BS_BATCH_SIZE;
+	ctx->partial_len = 0;
+}
+
+void present_bs_aead_aad(present_bs_aead_t *ctx, const uint8_t *aad, size_t len)
+{
+	hash_absorb(ctx, aad, len);
+	ctx->aad_len += len;
+}
+
+/*
+ * present_bs_aead_encrypt is the fused single pass. The keystream is produced one
+ * bitsliced batch at a time, and each chunk of at most one batch is XORed and
+ * immediately absorbed into the hash, while the ciphertext is still in cache.
+ */
+void present_bs_aead_encrypt(present_bs_aead_t *ctx, const uint8_t *in, uint8_t *out, size_t len)
+{
+	if (ctx->msg_len == 0)
+	{
+		hash_pad(ctx);
+	}
+
+	ctx->msg_len += len;
+
+	while (len)
+	{
+		if (ctx->stream_pos == PRESENT_BS_BATCH_SIZE)
+		{
+			present_bs_ctr_keystream(ctx->ks, ctx->ctr, ctx->stream);
+			ctx->ctr += BITSLICE_WIDTH;
+			ctx->stream_pos = 0;
+		}
+
+		size_t n = PRESENT_BS_BATCH_SIZE - ctx->stream_pos;
+		n = len < n ? len : n;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			out[i] = in[i] ^ ctx->stream[ctx->stream_pos + i];
+		}
+
+		hash_absorb(ctx, out, n);
+
+		ctx->stream_pos += n;
+		in += n;
+		out += n;
+		len -= n;
+	}
+}
+
+/*
+ * present_bs_aead_final closes the hash with a block holding the byte lengths of the
+ * associated data (lower half) and of the message (upper half), and masks the result.
+ */
+void present_bs_aead_final(present_bs_aead_t *ctx, uint8_t tag[PRESENT_BS_AEAD_TAG_SIZE])
+{
+	hash_pad(ctx);
+	ctx->x = gf64_mul(ctx->x ^ (ctx->aad_len | (ctx->msg_len << 32)), ctx->h);
+	put64(tag, ctx->x ^ ctx->mask);
+}
+
+/*
+ * present_bs_aead_verify checks the tag of a ciphertext without decrypting it. The
+ * ciphertext is only hashed, so the keystream is not computed at all.
+ * Returns 0 if the tag matches, -1 otherwise.
+ */
+int present_bs_aead_verify(const present_bs_key_t *ks, uint32_t nonce, const uint8_t *aad, size_t aad_len,
+	const uint8_t *ct, size_t len, const uint8_t tag[PRESENT_BS_AEAD_TAG_SIZE])
+{
+	present_bs_aead_t ctx;
+	uint8_t expected[PRESENT_BS_AEAD_TAG_SIZE];
+	uint8_t diff = 0;
+
+	present_bs_aead_init(&ctx, ks, nonce);
+	present_bs_aead_aad(&ctx, aad, aad_len);
+	hash_pad(&ctx);
+	hash_absorb(&ctx, ct, len);
+	ctx.msg_len = len;
+	present_bs_aead_final(&ctx, expected);
+
+	// compare every byte so that the time taken does not leak the first mismatch
+	for (uint8_t i = 0; i < PRESENT_BS_AEAD_TAG_SIZE; i++)
+	{
+		diff |= expected[i] ^ tag[i];
+	}
+
+	return diff ? -1 : 0;
+}
+
+/*
+ * present_bs_aead_decrypt verifies the tag first and only then runs CTR over the
+ * ciphertext, so pt is never written for a message that fails authentication.
+ * Returns 0 on success, -1 if the tag does not match.
+ */
+int present_bs_aead_decrypt(const present_bs_key_t *ks, uint32_t nonce, const uint8_t *aad, size_t aad_len,
+	const uint8_t *ct, uint8_t *pt, size_t len, const uint8_t tag[PRESENT_BS_AEAD_TAG_SIZE])
+{
+	if (present_bs_aead_verify(ks, nonce, aad, aad_len, ct, len, tag))
+	{
+		return -1;
+	}
+
+	present_bs_ctr_xor(ks, PRESENT_BS_AEAD_CTR(nonce, 0), ct, pt, len);
+
+	return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef PRESENT_BS_AEAD_H
+#define PRESENT_BS_AEAD_H
+
+#include "present_bs.h"
+
+#define PRESENT_BS_AEAD_TAG_SIZE CRYPTO_IN_SIZE
+
+/*
+ * Counter block layout of the AEAD mode: the 32-bit nonce fills the upper half,
+ * the lower half counts blocks. Counter 0 of nonce 0 derives the hash key, counter 1
+ * masks the tag and the message keystream starts at counter 32, so that every
+ * keystream batch starts on a lane aligned counter.
+ */
+#define PRESENT_BS_AEAD_CTR(nonce, i) (((uint64_t)(nonce) << 32) | (uint32_t)(32 + (i)))
+
+/*
+ * Incremental state of one message. aad has to be passed before any message data,
+ * and neither the associated data nor the message may exceed 2^32 - 1 bytes.
+ */
+typedef struct
+{
+	const present_bs_key_t *ks;
+	uint64_t h;
+	uint64_t x;
+	uint64_t mask;
+	uint64_t ctr;
+	uint64_t aad_len;
+	uint64_t msg_len;
+	uint8_t stream[PRESENT_BS_BATCH_SIZE];
+	uint32_t stream_pos;
+	uint8_t partial[CRYPTO_IN_SIZE];
+	uint8_t partial_len;
+} present_bs_aead_t;
+
+void present_bs_aead_init(present_bs_aead_t *ctx, const present_bs_key_t *ks, uint32_t nonce);
+void present_bs_aead_aad(present_bs_aead_t *ctx, const uint8_t *aad, size_t len);
+void present_bs_aead_encrypt(present_bs_aead_t *ctx, const uint8_t *in, uint8_t *out, size_t len);
+void present_bs_aead_final(present_bs_aead_t *ctx, uint8_t tag[PRESENT_BS_AEAD_TAG_SIZE]);
+
+int present_bs_aead_verify(const present_bs_key_t *ks, uint32_t nonce, const uint8_t *aad, size_t aad_len,
+	const uint8_t *ct, size_t len, const uint8_t tag[PRESENT_BS_AEAD_TAG_SIZE]);
+int present_bs_aead_decrypt(const present_bs_key_t *ks, uint32_t nonce, const uint8_t *aad, size_t aad_len,
+	const uint8_t *ct, uint8_t *pt, size_t len, const uint8_t tag[PRESENT_BS_AEAD_TAG_SIZE]);
+
+#endif
@@ -0,0 +1,142 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "arena.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/*
+ * present_bs_arena_init sets up an arena on memory owned by the caller, e.g. a
+ * static buffer per core. The start is moved up to the next aligned address, so
+ * mem itself does not have to be aligned.
+ */
+void present_bs_arena_init(present_bs_arena_t *a, void *mem, size_t size)
+{
+	uintptr_t p = (uintptr_t)mem;
+	size_t skip = (size_t)((PRESENT_BS_ARENA_ALIGN - p % PRESENT_BS_ARENA_ALIGN) % PRESENT_BS_ARENA_ALIGN);
+
+	a->base = (uint8_t *)mem + (skip < size ? skip : size);
+	a->size = skip < size ? size - skip : 0;
+	a->used = 0;
+	a->mapped = 0;
+}
+
+/*
+ * present_bs_arena_alloc returns size bytes aligned to PRESENT_BS_ARENA_ALIGN, or 0
+ * if the arena is full. The size is rounded up as well, so allocations never share
+ * a cache line.
+ */
+void *present_bs_arena_alloc(present_bs_arena_t *a, size_t size)
+{
+	size_t rounded = (size + PRESENT_BS_ARENA_ALIGN - 1) & ~(size_t)(PRESENT_BS_ARENA_ALIGN - 1);
+
+	if (rounded < size || rounded > a->size - a->used)
+	{
+		return 0;
+	}
+
+	void *p = a->base + a->used;
+	a->used += rounded;
+
+	return p;
+}
+
+// present_bs_arena_mark and present_bs_arena_release free everything allocated in between
+size_t present_bs_arena_mark(const present_bs_arena_t *a)
+{
+	return a->used;
+}
+
+void present_bs_arena_release(present_bs_arena_t *a, size_t mark)
+{
+	if (mark < a->used)
+	{
+		a->used = mark;
+	}
+}
+
+// present_bs_arena_reset frees everything at once, e.g. at the end of a job
+void present_bs_arena_reset(present_bs_arena_t *a)
+{
+	a->used = 0;
+}
+
+// count batch buffers of PRESENT_BS_BATCH_SIZE bytes, back to back
+uint8_t *present_bs_arena_batches(present_bs_arena_t *a, size_t count)
+{
+	if (count > (size_t)-1 / PRESENT_BS_BATCH_SIZE)
+	{
+		return 0;
+	}
+
+	return present_bs_arena_alloc(a, count * PRESENT_BS_BATCH_SIZE);
+}
+
+present_bs_state_t *present_bs_arena_states(present_bs_arena_t *a, size_t count)
+{
+	if (count > (size_t)-1 / sizeof(present_bs_state_t))
+	{
+		return 0;
+	}
+
+	return present_bs_arena_alloc(a, count * sizeof(present_bs_state_t));
+}
+
+present_bs_key_t *present_bs_arena_keys(present_bs_arena_t *a, size_t count)
+{
+	if (count > (size_t)-1 / sizeof(present_bs_key_t))
+	{
+		return 0;
+	}
+
+	return present_bs_arena_alloc(a, count * sizeof(present_bs_key_t));
+}
+
+#if defined(__linux__)
+/*
+ * present_bs_arena_map backs an arena with fresh pages from the kernel instead of
+ * caller memory. With huge set, huge pages are tried first, which keeps large batch
+ * buffers in few TLB entries, and normal pages are used if none are available.
+ * Returns 0 on success and -1 if no memory could be mapped.
+ */
+int present_bs_arena_map(present_bs_arena_t *a, size_t size, int huge)
+{
+	void *mem = MAP_FAILED;
+
+#if defined(MAP_HUGETLB)
+	if (huge)
+	{
+		mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+#else
+	(void)huge;
+#endif
+
+	if (mem == MAP_FAILED)
+	{
+		mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+
+	if (mem == MAP_FAILED)
+	{
+		return -1;
+	}
+
+	present_bs_arena_init(a, mem, size);
+	a->mapped = 1;
+
+	return 0;
+}
+
+void present_bs_arena_unmap(present_bs_arena_t *a)
+{
+	if (a->mapped)
+	{
+		munmap(a->base, a->size);
+		a->mapped = 0;
+	}
+}
+#endif
@@ -0,0 +1,39 @@
+#ifndef PRESENT_BS_ARENA_H
+#define PRESENT_BS_ARENA_H
+
+#include "present_bs.h"
+
+// Alignment of every allocation, one cache line
+#ifndef PRESENT_BS_ARENA_ALIGN
+#define PRESENT_BS_ARENA_ALIGN 64
+#endif
+
+/*
+ * Bump allocator over one slab of memory. Allocation moves an offset forward and
+ * reset moves it back to 0, both O(1), and nothing is ever freed on its own. There
+ * is no locking, every thread or core is meant to own its own arena.
+ */
+typedef struct
+{
+	uint8_t *base;
+	size_t size;
+	size_t used;
+	uint8_t mapped;
+} present_bs_arena_t;
+
+void present_bs_arena_init(present_bs_arena_t *a, void *mem, size_t size);
+void *present_bs_arena_alloc(present_bs_arena_t *a, size_t size);
+size_t present_bs_arena_mark(const present_bs_arena_t *a);
+void present_bs_arena_release(present_bs_arena_t *a, size_t mark);
+void present_bs_arena_reset(present_bs_arena_t *a);
+
+uint8_t *present_bs_arena_batches(present_bs_arena_t *a, size_t count);
+present_bs_state_t *present_bs_arena_states(present_bs_arena_t *a, size_t count);
+present_bs_key_t *present_bs_arena_keys(present_bs_arena_t *a, size_t count);
+
+#if defined(__linux__)
+int present_bs_arena_map(present_bs_arena_t *a, size_t size, int huge);
+void present_bs_arena_unmap(present_bs_arena_t *a);
+#endif
+
+#endif
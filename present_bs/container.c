@@ -0,0 +1,173 @@
+#include "container.h"
+#include "aead.h"
+#include "util.h"
+
+// data_offset returns where the chunk data starts, right after the aligned MAC table
+static size_t data_offset(uint32_t chunk_count)
+{
+	size_t off = PRESENT_BS_CONTAINER_HEADER_SIZE + (size_t)chunk_count * PRESENT_BS_AEAD_TAG_SIZE;
+	return (off + PRESENT_BS_CONTAINER_ALIGN - 1) & ~(size_t)(PRESENT_BS_CONTAINER_ALIGN - 1);
+}
+
+static uint32_t chunk_count(uint64_t len, uint32_t chunk_size)
+{
+	return (uint32_t)((len + chunk_size - 1) / chunk_size);
+}
+
+// present_bs_container_size returns the number of bytes needed to seal len bytes
+size_t present_bs_container_size(uint64_t len, uint32_t chunk_size)
+{
+	return data_offset(chunk_count(len, chunk_size)) + (size_t)len;
+}
+
+/*
+ * present_bs_container_seal writes a complete container for pt into out, which
+ * has to hold present_bs_container_size bytes. Every chunk goes through the fused
+ * AEAD pass once. Returns -1 if chunk_size is not a multiple of CRYPTO_IN_SIZE or
+ * pt needs more chunks than the nonce space allows, 0 otherwise.
+ */
+int present_bs_container_seal(const present_bs_key_t *ks, uint64_t file_id, uint32_t chunk_size,
+	const uint8_t *pt, uint64_t len, uint8_t *out)
+{
+	if (chunk_size == 0 || chunk_size % CRYPTO_IN_SIZE || (len + chunk_size - 1) / chunk_size > 0xFFFFFFFFu)
+	{
+		return -1;
+	}
+
+	uint32_t count = chunk_count(len, chunk_size);
+	uint8_t *data = out + data_offset(count);
+
+	for (size_t i = 0; i < data_offset(count); i++)
+	{
+		out[i] = 0;
+	}
+
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		out[i] = (uint8_t)PRESENT_BS_CONTAINER_MAGIC[i];
+	}
+
+	put32(out + 8, PRESENT_BS_CONTAINER_VERSION);
+	put32(out + 12, chunk_size);
+	put64(out + 16, len);
+	put64(out + 24, file_id);
+	put32(out + 32, count);
+
+	for (uint32_t c = 0; c < count; c++)
+	{
+		uint64_t off = (uint64_t)c * chunk_size;
+		size_t n = len - off < chunk_size ? (size_t)(len - off) : chunk_size;
+		present_bs_aead_t ctx;
+
+		present_bs_aead_init(&ctx, ks, c);
+		present_bs_aead_aad(&ctx, out, PRESENT_BS_CONTAINER_HEADER_SIZE);
+		present_bs_aead_encrypt(&ctx, pt + off, data + off, n);
+		present_bs_aead_final(&ctx, out + PRESENT_BS_CONTAINER_HEADER_SIZE + (size_t)c * PRESENT_BS_AEAD_TAG_SIZE);
+	}
+
+	return 0;
+}
+
+/*
+ * present_bs_container_open checks the header of a container in memory, e.g. a
+ * mapped file, and sets up c to point into it. Nothing is copied, buf has to stay
+ * valid as long as c is used. Returns 0 on success and -1 if buf is not a well
+ * formed container.
+ */
+int present_bs_container_open(present_bs_container_t *c, const uint8_t *buf, size_t size)
+{
+	if (size < PRESENT_BS_CONTAINER_HEADER_SIZE)
+	{
+		return -1;
+	}
+
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		if (buf[i] != (uint8_t)PRESENT_BS_CONTAINER_MAGIC[i])
+		{
+			return -1;
+		}
+	}
+
+	c->chunk_size = get32(buf + 12);
+	c->len = get64(buf + 16);
+	c->file_id = get64(buf + 24);
+	c->chunk_count = get32(buf + 32);
+
+	if (get32(buf + 8) != PRESENT_BS_CONTAINER_VERSION || c->chunk_size == 0 || c->chunk_size % CRYPTO_IN_SIZE
+		|| (uint64_t)c->chunk_count * c->chunk_size < c->len
+		|| c->chunk_count != chunk_count(c->len, c->chunk_size)
+		|| size < data_offset(c->chunk_count) || size - data_offset(c->chunk_count) < c->len)
+	{
+		return -1;
+	}
+
+	c->header = buf;
+	c->tags = buf + PRESENT_BS_CONTAINER_HEADER_SIZE;
+	c->data = buf + data_offset(c->chunk_count);
+
+	return 0;
+}
+
+/*
+ * present_bs_container_read decrypts the byte range [off, off + len) into out.
+ * For every chunk the range touches, the chunk tag is verified first (this only
+ * hashes the chunk), and then exactly the keystream blocks covering the requested
+ * bytes are computed, starting from the counter of the first block needed.
+ * Returns 0 on success and -1 if the range is out of bounds or a tag does not
+ * match; out may then hold plaintext of chunks before the failing one.
+ */
+int present_bs_container_read(const present_bs_container_t *c, const present_bs_key_t *ks,
+	uint64_t off, uint8_t *out, size_t len)
+{
+	if (off > c->len || c->len - off < len)
+	{
+		return -1;
+	}
+
+	while (len)
+	{
+		uint32_t chunk = (uint32_t)(off / c->chunk_size);
+		uint64_t chunk_off = (uint64_t)chunk * c->chunk_size;
+		size_t chunk_len = c->len - chunk_off < c->chunk_size ? (size_t)(c->len - chunk_off) : c->chunk_size;
+		size_t pos = (size_t)(off - chunk_off);
+		size_t n = chunk_len - pos < len ? chunk_len - pos : len;
+		const uint8_t *ct = c->data + chunk_off;
+
+		if (present_bs_aead_verify(ks, chunk, c->header, PRESENT_BS_CONTAINER_HEADER_SIZE, ct, chunk_len,
+			c->tags + (size_t)chunk * PRESENT_BS_AEAD_TAG_SIZE))
+		{
+			return -1;
+		}
+
+		size_t block = pos / CRYPTO_IN_SIZE;
+		size_t skip = pos % CRYPTO_IN_SIZE;
+		size_t done = 0;
+
+		// a range starting inside a block needs that block on its own
+		if (skip)
+		{
+			uint8_t tmp[CRYPTO_IN_SIZE];
+			size_t m = CRYPTO_IN_SIZE - skip < n ? CRYPTO_IN_SIZE - skip : n;
+
+			present_bs_ctr_xor(ks, PRESENT_BS_AEAD_CTR(chunk, block), ct + block * CRYPTO_IN_SIZE, tmp,
+				skip + m);
+
+			for (size_t i = 0; i < m; i++)
+			{
+				out[i] = tmp[skip + i];
+			}
+
+			done = m;
+			block++;
+		}
+
+		present_bs_ctr_xor(ks, PRESENT_BS_AEAD_CTR(chunk, block), ct + pos + done, out + done, n - done);
+
+		off += n;
+		out += n;
+		len -= n;
+	}
+
+	return 0;
+}
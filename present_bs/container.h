@@ -0,0 +1,47 @@
+#ifndef PRESENT_BS_CONTAINER_H
+#define PRESENT_BS_CONTAINER_H
+
+#include "present_bs.h"
+
+#define PRESENT_BS_CONTAINER_MAGIC "PRSTCNT1"
+#define PRESENT_BS_CONTAINER_VERSION 1
+
+// Header and data area are aligned to this, so a mapped file can be used in place
+#define PRESENT_BS_CONTAINER_ALIGN 64
+#define PRESENT_BS_CONTAINER_HEADER_SIZE 64
+
+/*
+ * Seekable container layout, all fields little endian:
+ *
+ *   0   magic "PRSTCNT1"
+ *   8   u32 version
+ *   12  u32 chunk size in bytes, a non-zero multiple of CRYPTO_IN_SIZE
+ *   16  u64 plaintext length
+ *   24  u64 file id, free for the caller, e.g. to derive the container key
+ *   32  u32 chunk count
+ *   36  zero up to PRESENT_BS_CONTAINER_HEADER_SIZE
+ *   64  MAC table, one AEAD tag per chunk
+ *       chunk data, starting at the next PRESENT_BS_CONTAINER_ALIGN boundary
+ *
+ * Chunk c is encrypted with the AEAD mode using nonce c and the header as associated
+ * data. As the nonce is the chunk index, every container needs its own key.
+ */
+typedef struct
+{
+	const uint8_t *header;
+	const uint8_t *tags;
+	const uint8_t *data;
+	uint32_t chunk_size;
+	uint32_t chunk_count;
+	uint64_t len;
+	uint64_t file_id;
+} present_bs_container_t;
+
+size_t present_bs_container_size(uint64_t len, uint32_t chunk_size);
+int present_bs_container_seal(const present_bs_key_t *ks, uint64_t file_id, uint32_t chunk_size,
+	const uint8_t *pt, uint64_t len, uint8_t *out);
+int present_bs_container_open(present_bs_container_t *c, const uint8_t *buf, size_t size);
+int present_bs_container_read(const present_bs_container_t *c, const present_bs_key_t *ks,
+	uint64_t off, uint8_t *out, size_t len);
+
+#endif
@@ -1,250 +1,1156 @@
-#include "crypto.h"
-
-/**
- * Bring normal buffer into bitsliced form
- * @param pt Input: state_bs in normal form
- * @param state_bs Output: Bitsliced state
- * 
- * enslice turns a normal buffer pt into an ensliced form, which gets stored in state_bs.
- * The outer for loop iterates over all the entries in the permuted state state_bs,
- * and fills each entry one by one by grabbing the appropriate bits.
- * The inner loop fills up the individual bits within each entry by taking the
- * appropriate bit from the pt state array. The appropriate bit is found as follows:
- * 
- * 0. pt[i / 8 + bit * 8] retrieves the correct pt entry that holds the appropriate bit.
- * 1. Each entry within the pt array is 8-bit, therefore pt[...] >> (i % 8) to retrieve one bit
- * 2. (... & 1) is used to mask the shifted bit, the rest of the bits become 0
- * 3. (... << bit) shifts the retrieved bit to an appropriate bit position in state_bs[i].
- * 4. The shifted bit can be safely ORed with state_bs[i] as all the un-used bits are 0.
- */
-static void enslice(const uint8_t pt[CRYPTO_IN_SIZE * BITSLICE_WIDTH], bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
-{
-	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
-	{
-		bs_reg_t temp = 0;
-
-		for (uint8_t bit = 0; bit < BITSLICE_WIDTH; bit++)
-		{
-			temp |= ((pt[i / 8 + bit * 8] >> (i % 8)) & 1) << bit;
-		}
-
-		state_bs[i] = temp;
-	}
-}
-
-/**
- * Bring bitsliced buffer into normal form
- * @param state_bs Input: Bitsliced state
- * @param pt Output: state_bs in normal form
- * 
- * The unslice function is an inverse function to enslice. It converts a bitsliced
- * buffer state_bs back into the standard buffer pt. The outer loop interates over all
- * the entries in the output array pt, and fills each entry one by one.
- * The inner loop iterates over each individual bit of one entry of pt, and sets these
- * bits one by one by using OR to combine them. The bits are set as follows:
- * 
- * 0. state_bs[((i * 8) % CRYPTO_IN_SIZE_BIT) + bit] retrieves the correct state_bs that holds the appropriate bit.
- * 1. For pt[0] through pt[7] we need to take the first bit of each entry in state_bs, and so on. state_bs[...] >> (i / 8) does this.
- * 2. (... & 1) is used to mask the shifted bit, the rest of the bits become 0
- * 3. (... << bit) shifts the retrieved bit to an appropriate bit position in pt[i].
- * 4. The shifted bit can be safely ORed with pt[i] as all the un-used bits are 0.
- */
-static void unslice(const bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], uint8_t pt[CRYPTO_IN_SIZE * BITSLICE_WIDTH])
-{
-	for (uint32_t i = 0; i < (CRYPTO_IN_SIZE * BITSLICE_WIDTH); i++)
-	{
-		uint8_t temp = 0;
-		
-		for (uint8_t bit = 0; bit < 8; bit++)
-		{
-			temp |= ((state_bs[((i * 8) % CRYPTO_IN_SIZE_BIT) + bit] >> (i / 8)) & 1) << bit;
-		}
-
-		pt[i] = temp;
-	}
-
-}
-
-/*
- * The sbox0, sbox1, sbox2 and sbox3 compute the SBoxes for bitsliced PRESENT.
- * These SBoxes have been optimised to reduce redundacy, therefore some computations
- * have been rearranged, and some intermediate computations have been introduced to store
- * and re-use the same computation in multiple places, which speeds up the bitsliced implementation.
- * Constant BS_INV helps to compute the negation.
- */
-#define BS_INV 0xFFFFFFFF
-
-static bs_reg_t sbox0(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
-{
-	return x0 ^ (x1 & x2) ^ x2 ^ x3;
-}
-
-static bs_reg_t sbox1(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
-{
-	bs_reg_t c = x2 & x3;
-	return ((x0 & x1) & (x2 ^ x3)) ^ (x3 & x1) ^ x1 ^ (x0 & c) ^ c ^ x3;
-}
-
-static bs_reg_t sbox2(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
-{
-	bs_reg_t c = x0 & x3;
-	return (x0 & x1) ^ (c & x1) ^ (x3 & x1) ^ x2 ^ c ^ (c & x2) ^ x3 ^ BS_INV;
-}
-
-static bs_reg_t sbox3(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
-{
-	bs_reg_t c = x1 & x2;
-	return (c & x0) ^ ((x3 & x0) & (x1 ^ x2)) ^ x0 ^ x1 ^ c ^ x3 ^ BS_INV;
-}
-
-/*
- * add_round_key adds the roundkey to the bitsliced implementation of PRESENT.
- * It iterates over every entry in state_bs one by one, and XORs the whole entry
- * with either 0xFFFFFFFF or 0x00000000, depending on the appropriate bit within the roundkey.
- * This roundkey conversion is needed because the roundkey is not stored in bitsliced form.
- * 
- * The (uint8_t key_bit) retrieves the appropriate bit within the roundkey, and masks it with 1
- * so only that bit remains. If the key bit is one, the state_bs is XORed with 0xFFFFFFFF, and vice versa.
- * As such, all bits within one state_bs entry are XORed with the same roundkey bit.
- * 
- * roundkey[bit / CRYPTO_IN_SIZE] gets the appropriate byte of the roundkey.
- * roundkey[...] >> (bit % CRYPTO_IN_SIZE) gets the appropriate bit of the roundkey.
- */
-static void add_round_key(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], uint8_t roundkey[CRYPTO_IN_SIZE])
-{
-	for (uint8_t bit = 0; bit < CRYPTO_IN_SIZE_BIT; bit++)
-	{
-		uint8_t key_bit = (roundkey[bit / CRYPTO_IN_SIZE] >> (bit % CRYPTO_IN_SIZE)) & 1;
-		state_bs[bit] ^= (key_bit ? 0xFFFFFFFF : 0);
-	}
-}
-
-/*
- * sbox_layer applies the sbox transformation. This bitsliced implementation
- * is very different from the standard implementation, as it no longer uses lookup tables.
- * Instead, it uses four functions sbox0, sbox1, sbox2, sbox3 to compute the SBox.
- * 
- * It retrieves chunks of 4 bits in every iteration of the for loop, and passes these chunks
- * of 4 bits into the SBox. The SBox is computed for all 32 bits of one state_bs entry in one iteration.
- * Therefore, only 16 iterations are needed to loop over the entire state_bs array and apply SBox to all bits.
- * 
- * The outputs are stored in the temporary output state_out in the same order but with SBox applied.
- */
-static void sbox_layer(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
-{
-	bs_reg_t state_out[CRYPTO_IN_SIZE_BIT] = { 0 };
-
-	for (uint8_t i = 0; i < 16; i++)
-	{
-		bs_reg_t in0 = state_bs[i * 4 + 0];
-		bs_reg_t in1 = state_bs[i * 4 + 1];
-		bs_reg_t in2 = state_bs[i * 4 + 2];
-		bs_reg_t in3 = state_bs[i * 4 + 3];
-
-		state_out[i * 4 + 0] = sbox0(in0, in1, in2, in3);
-		state_out[i * 4 + 1] = sbox1(in0, in1, in2, in3);
-		state_out[i * 4 + 2] = sbox2(in0, in1, in2, in3);
-		state_out[i * 4 + 3] = sbox3(in0, in1, in2, in3);
-	}
-	
-	// copy the temporary output state_out into the bitsliced state state_bs
-	// to reflect the changes and prevent overwriting entries.
-	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
-	{
-		state_bs[i] = state_out[i];
-	}
-}
-
-/*
- * pbox_layer applies the permutation transformation. The bitsliced implementation of PRESENT
- * allows for an extremely fast and simple permutation implementation.
- * The pbox_layer no longer has to extract individual bits, therefore it is much faster.
- * 
- * It only computes the permuted position of the bit, and moves the whole state_bs entry into
- * the permuted position. This permutes all 32 states at once.
- */
-static void pbox_layer(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
-{
-	bs_reg_t state_out[CRYPTO_IN_SIZE_BIT] = { 0 };
-
-	for (uint8_t bit = 0; bit < CRYPTO_IN_SIZE_BIT; bit++)
-	{
-		uint8_t out = (bit / 4) + (bit % 4) * 16; // compute the permuted position
-		state_out[out] = state_bs[bit];
-	}
-
-	// copy the temporary output state_out into the bitsliced state state_bs
-	// to reflect the changes and prevent overwriting entries.
-	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
-	{
-		state_bs[i] = state_out[i];
-	}
-}
-
-/**
- * Perform next key schedule step
- * @param key Key register to be updated
- * @param r Round counter
- * @warning For correct function, has to be called with incremented r each time
- * @note You are free to change or optimize this function
- */
-static void update_round_key(uint8_t key[CRYPTO_KEY_SIZE], const uint8_t r)
-{
-	const uint8_t sbox[16] = {
-		0xC, 0x5, 0x6, 0xB, 0x9, 0x0, 0xA, 0xD, 0x3, 0xE, 0xF, 0x8, 0x4, 0x7, 0x1, 0x2,
-	};
-
-	uint8_t tmp = 0;
-	const uint8_t tmp2 = key[2];
-	const uint8_t tmp1 = key[1];
-	const uint8_t tmp0 = key[0];
-	
-	// rotate right by 19 bit
-	key[0] = key[2] >> 3 | key[3] << 5;
-	key[1] = key[3] >> 3 | key[4] << 5;
-	key[2] = key[4] >> 3 | key[5] << 5;
-	key[3] = key[5] >> 3 | key[6] << 5;
-	key[4] = key[6] >> 3 | key[7] << 5;
-	key[5] = key[7] >> 3 | key[8] << 5;
-	key[6] = key[8] >> 3 | key[9] << 5;
-	key[7] = key[9] >> 3 | tmp0 << 5;
-	key[8] = tmp0 >> 3   | tmp1 << 5;
-	key[9] = tmp1 >> 3   | tmp2 << 5;
-	
-	// perform sbox lookup on MSbits
-	tmp = sbox[key[9] >> 4];
-	key[9] &= 0x0F;
-	key[9] |= tmp << 4;
-	
-	// XOR round counter k19 ... k15
-	key[1] ^= r << 7;
-	key[2] ^= r >> 1;
-}
-
-void crypto_func(uint8_t pt[CRYPTO_IN_SIZE * BITSLICE_WIDTH], uint8_t key[CRYPTO_KEY_SIZE])
-{
-	// State buffer and additional backbuffer of same size
-	bs_reg_t state[CRYPTO_IN_SIZE_BIT];
-	bs_reg_t bb[CRYPTO_IN_SIZE_BIT];
-	
-	uint8_t round;
-	uint8_t i;
-	
-	// Bring into bitslicing form
-	enslice(pt, state);
-	
-	// PRESENT main code, nearly identical to the PRESENT paper
-	// although instead of the original state s, a bitsliced state is used
-	for(i = 1; i <= 31; i++)
-	{
-		add_round_key(state, key + 2);
-		sbox_layer(state);
-		pbox_layer(state);
-		update_round_key(key, i);
-	}
-	
-	add_round_key(state, key + 2);
-		
-	// Convert back to normal form
-	unslice(state, pt);
-}
\ No newline at end of file
+#include "crypto.h"
+#include "present_bs.h"
+
+/**
+ * Bring normal buffer into bitsliced form
+ * @param pt Input: state_bs in normal form
+ * @param state_bs Output: Bitsliced state
+ * 
+ * enslice turns a normal buffer pt into an ensliced form, which gets stored in state_bs.
+ * The outer for loop iterates over all the entries in the permuted state state_bs,
+ * and fills each entry one by one by grabbing the appropriate bits.
+ * The inner loop fills up the individual bits within each entry by taking the
+ * appropriate bit from the pt state array. The appropriate bit is found as follows:
+ * 
+ * 0. pt[i / 8 + bit * 8] retrieves the correct pt entry that holds the appropriate bit.
+ * 1. Each entry within the pt array is 8-bit, therefore pt[...] >> (i % 8) to retrieve one bit
+ * 2. (... & 1) is used to mask the shifted bit, the rest of the bits become 0
+ * 3. (... << bit) shifts the retrieved bit to an appropriate bit position in state_bs[i].
+ * 4. The shifted bit can be safely ORed with state_bs[i] as all the un-used bits are 0.
+ */
+static void enslice(const uint8_t pt[CRYPTO_IN_SIZE * BITSLICE_WIDTH], bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
+{
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+	{
+		bs_reg_t temp = 0;
+
+		for (uint8_t bit = 0; bit < BITSLICE_WIDTH; bit++)
+		{
+			temp |= ((pt[i / 8 + bit * 8] >> (i % 8)) & 1) << bit;
+		}
+
+		state_bs[i] = temp;
+	}
+}
+
+/**
+ * Bring bitsliced buffer into normal form
+ * @param state_bs Input: Bitsliced state
+ * @param pt Output: state_bs in normal form
+ * 
+ * The unslice function is an inverse function to enslice. It converts a bitsliced
+ * buffer state_bs back into the standard buffer pt. The outer loop interates over all
+ * the entries in the output array pt, and fills each entry one by one.
+ * The inner loop iterates over each individual bit of one entry of pt, and sets these
+ * bits one by one by using OR to combine them. The bits are set as follows:
+ * 
+ * 0. state_bs[((i * 8) % CRYPTO_IN_SIZE_BIT) + bit] retrieves the correct state_bs that holds the appropriate bit.
+ * 1. For pt[0] through pt[7] we need to take the first bit of each entry in state_bs, and so on. state_bs[...] >> (i / 8) does this.
+ * 2. (... & 1) is used to mask the shifted bit, the rest of the bits become 0
+ * 3. (... << bit) shifts the retrieved bit to an appropriate bit position in pt[i].
+ * 4. The shifted bit can be safely ORed with pt[i] as all the un-used bits are 0.
+ */
+static void unslice(const bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], uint8_t pt[CRYPTO_IN_SIZE * BITSLICE_WIDTH])
+{
+	for (uint32_t i = 0; i < (CRYPTO_IN_SIZE * BITSLICE_WIDTH); i++)
+	{
+		uint8_t temp = 0;
+		
+		for (uint8_t bit = 0; bit < 8; bit++)
+		{
+			temp |= ((state_bs[((i * 8) % CRYPTO_IN_SIZE_BIT) + bit] >> (i / 8)) & 1) << bit;
+		}
+
+		pt[i] = temp;
+	}
+
+}
+
+/**
+ * Bring the first n blocks of a buffer into bitsliced form
+ * @param pt Input: n blocks in normal form
+ * @param n Number of blocks, lanes n ... BITSLICE_WIDTH - 1 are set to 0
+ * @param state_bs Output: Bitsliced state
+ *
+ * Same as enslice, but only reads the blocks that are there, for partial batches.
+ */
+static void enslice_lanes(const uint8_t *pt, uint32_t n, bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
+{
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+	{
+		bs_reg_t temp = 0;
+
+		for (uint32_t lane = 0; lane < n; lane++)
+		{
+			temp |= (bs_reg_t)((pt[i / 8 + lane * 8] >> (i % 8)) & 1) << lane;
+		}
+
+		state_bs[i] = temp;
+	}
+}
+
+/**
+ * Bring selected lanes of a bitsliced state into normal form
+ * @param state_bs Input: Bitsliced state
+ * @param mask Lanes to extract, bit l selects lane l
+ * @param out Output: the selected blocks, packed one after another in lane order
+ *
+ * Unlike unslice, which always rebuilds all blocks, this only touches the entries
+ * for the lanes in mask, so the cost grows with the number of lanes requested.
+ */
+static void unslice_lanes(const bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], bs_reg_t mask, uint8_t *out)
+{
+	for (uint32_t lane = 0; lane < BITSLICE_WIDTH; lane++)
+	{
+		if (!((mask >> lane) & 1))
+		{
+			continue;
+		}
+
+		for (uint8_t i = 0; i < CRYPTO_IN_SIZE; i++)
+		{
+			uint8_t temp = 0;
+
+			for (uint8_t bit = 0; bit < 8; bit++)
+			{
+				temp |= ((state_bs[i * 8 + bit] >> lane) & 1) << bit;
+			}
+
+			out[i] = temp;
+		}
+
+		out += CRYPTO_IN_SIZE;
+	}
+}
+
+// lane_mask returns the mask of lanes 0 ... n - 1
+static bs_reg_t lane_mask(uint32_t n)
+{
+	return n >= BITSLICE_WIDTH ? (bs_reg_t)~(bs_reg_t)0 : (((bs_reg_t)1 << n) - 1);
+}
+
+#if BITSLICE_WIDTH == 32
+/*
+ * transpose32 transposes a 32x32 bit matrix in place, so that afterwards bit l of
+ * a[i] holds what was bit i of a[l]. Instead of moving single bits it swaps blocks
+ * of 16, 8, 4, 2 and 1 bits between pairs of rows, which takes 5 * 16 swaps.
+ */
+static void transpose32(uint32_t a[32])
+{
+	uint32_t m = 0x0000FFFF;
+
+	for (uint32_t j = 16; j != 0; j >>= 1, m ^= m << j)
+	{
+		for (uint32_t k = 0; k < 32; k = ((k | j) + 1) & ~j)
+		{
+			uint32_t t = ((a[k] >> j) ^ a[k | j]) & m;
+			a[k] ^= t << j;
+			a[k | j] ^= t;
+		}
+	}
+}
+#endif
+
+/**
+ * Bring 64-bit integers into bitsliced form
+ * @param v Input: up to BITSLICE_WIDTH blocks as integers, bit i of v[l] is bit i of lane l
+ * @param n Number of valid entries in v, the remaining lanes are set to 0
+ * @param state_bs Output: Bitsliced state
+ *
+ * A block in normal form is the little endian encoding of the integer, so no bytes
+ * have to be taken apart. With 32 lanes the low and the high halves of the integers
+ * each form a 32x32 bit matrix, and transposing them gives the state directly.
+ */
+static void enslice_u64(const uint64_t *v, uint32_t n, bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
+{
+#if BITSLICE_WIDTH == 32
+	for (uint32_t l = 0; l < 32; l++)
+	{
+		uint64_t x = l < n ? v[l] : 0;
+		state_bs[l] = (uint32_t)x;
+		state_bs[l + 32] = (uint32_t)(x >> 32);
+	}
+
+	transpose32(state_bs);
+	transpose32(state_bs + 32);
+#else
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+	{
+		bs_reg_t temp = 0;
+
+		for (uint32_t l = 0; l < n; l++)
+		{
+			temp |= (bs_reg_t)((v[l] >> i) & 1) << l;
+		}
+
+		state_bs[i] = temp;
+	}
+#endif
+}
+
+/**
+ * Bring bitsliced state back into 64-bit integers
+ * @param state_bs Input: Bitsliced state, clobbered
+ * @param v Output: the first n lanes as integers
+ * @param n Number of lanes to write
+ */
+static void unslice_u64(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], uint64_t *v, uint32_t n)
+{
+#if BITSLICE_WIDTH == 32
+	transpose32(state_bs);
+	transpose32(state_bs + 32);
+
+	for (uint32_t l = 0; l < n; l++)
+	{
+		v[l] = (uint64_t)state_bs[l] | ((uint64_t)state_bs[l + 32] << 32);
+	}
+#else
+	for (uint32_t l = 0; l < n; l++)
+	{
+		uint64_t temp = 0;
+
+		for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+		{
+			temp |= (uint64_t)((state_bs[i] >> l) & 1) << i;
+		}
+
+		v[l] = temp;
+	}
+#endif
+}
+
+/*
+ * The sbox0, sbox1, sbox2 and sbox3 compute the SBoxes for bitsliced PRESENT.
+ * These SBoxes have been optimised to reduce redundacy, therefore some computations
+ * have been rearranged, and some intermediate computations have been introduced to store
+ * and re-use the same computation in multiple places, which speeds up the bitsliced implementation.
+ * Constant BS_INV helps to compute the negation.
+ */
+#define BS_INV 0xFFFFFFFF
+
+static bs_reg_t sbox0(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
+{
+	return x0 ^ (x1 & x2) ^ x2 ^ x3;
+}
+
+static bs_reg_t sbox1(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
+{
+	bs_reg_t c = x2 & x3;
+	return ((x0 & x1) & (x2 ^ x3)) ^ (x3 & x1) ^ x1 ^ (x0 & c) ^ c ^ x3;
+}
+
+static bs_reg_t sbox2(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
+{
+	bs_reg_t c = x0 & x3;
+	return (x0 & x1) ^ (c & x1) ^ (x3 & x1) ^ x2 ^ c ^ (c & x2) ^ x3 ^ BS_INV;
+}
+
+static bs_reg_t sbox3(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
+{
+	bs_reg_t c = x1 & x2;
+	return (c & x0) ^ ((x3 & x0) & (x1 ^ x2)) ^ x0 ^ x1 ^ c ^ x3 ^ BS_INV;
+}
+
+/*
+ * The sbox_inv0, sbox_inv1, sbox_inv2 and sbox_inv3 compute the inverse SBox for
+ * bitsliced PRESENT decryption. They follow the algebraic normal form of the inverse
+ * SBox, again sharing the products that appear in more than one term.
+ */
+static bs_reg_t sbox_inv0(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
+{
+	return x0 ^ x2 ^ (x1 & x3) ^ BS_INV;
+}
+
+static bs_reg_t sbox_inv1(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
+{
+	bs_reg_t c = x0 & x2;
+	bs_reg_t d = x1 & x3;
+	return x0 ^ x1 ^ x3 ^ c ^ (c & x1) ^ d ^ (d & x0) ^ (x2 & x3) ^ (c & x3);
+}
+
+static bs_reg_t sbox_inv2(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
+{
+	bs_reg_t c = x0 & x1;
+	bs_reg_t d = x0 & x2;
+	return c ^ d ^ (x1 & x2) ^ (c & x2) ^ x3 ^ (x0 & x3) ^ (x1 & x3) ^ (c & x3) ^ (d & x3) ^ BS_INV;
+}
+
+static bs_reg_t sbox_inv3(bs_reg_t x0, bs_reg_t x1, bs_reg_t x2, bs_reg_t x3)
+{
+	bs_reg_t c = x0 & x1;
+	return x0 ^ x1 ^ c ^ x2 ^ (c & x2) ^ x3 ^ ((x0 & x2) & x3);
+}
+
+/*
+ * add_round_key adds the roundkey to the bitsliced implementation of PRESENT.
+ * It iterates over every entry in state_bs one by one, and XORs the whole entry
+ * with either 0xFFFFFFFF or 0x00000000, depending on the appropriate bit within the roundkey.
+ * This roundkey conversion is needed because the roundkey is not stored in bitsliced form.
+ * 
+ * The (uint8_t key_bit) retrieves the appropriate bit within the roundkey, and masks it with 1
+ * so only that bit remains. If the key bit is one, the state_bs is XORed with 0xFFFFFFFF, and vice versa.
+ * As such, all bits within one state_bs entry are XORed with the same roundkey bit.
+ * 
+ * roundkey[bit / CRYPTO_IN_SIZE] gets the appropriate byte of the roundkey.
+ * roundkey[...] >> (bit % CRYPTO_IN_SIZE) gets the appropriate bit of the roundkey.
+ */
+static void add_round_key(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], const uint8_t roundkey[CRYPTO_IN_SIZE])
+{
+	for (uint8_t bit = 0; bit < CRYPTO_IN_SIZE_BIT; bit++)
+	{
+		uint8_t key_bit = (roundkey[bit / CRYPTO_IN_SIZE] >> (bit % CRYPTO_IN_SIZE)) & 1;
+		state_bs[bit] ^= (key_bit ? 0xFFFFFFFF : 0);
+	}
+}
+
+/*
+ * sbox_layer applies the sbox transformation. This bitsliced implementation
+ * is very different from the standard implementation, as it no longer uses lookup tables.
+ * Instead, it uses four functions sbox0, sbox1, sbox2, sbox3 to compute the SBox.
+ * 
+ * It retrieves chunks of 4 bits in every iteration of the for loop, and passes these chunks
+ * of 4 bits into the SBox. The SBox is computed for all 32 bits of one state_bs entry in one iteration.
+ * Therefore, only 16 iterations are needed to loop over the entire state_bs array and apply SBox to all bits.
+ * 
+ * The outputs are stored in the temporary output state_out in the same order but with SBox applied.
+ */
+static void sbox_layer(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
+{
+	bs_reg_t state_out[CRYPTO_IN_SIZE_BIT] = { 0 };
+
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		bs_reg_t in0 = state_bs[i * 4 + 0];
+		bs_reg_t in1 = state_bs[i * 4 + 1];
+		bs_reg_t in2 = state_bs[i * 4 + 2];
+		bs_reg_t in3 = state_bs[i * 4 + 3];
+
+		state_out[i * 4 + 0] = sbox0(in0, in1, in2, in3);
+		state_out[i * 4 + 1] = sbox1(in0, in1, in2, in3);
+		state_out[i * 4 + 2] = sbox2(in0, in1, in2, in3);
+		state_out[i * 4 + 3] = sbox3(in0, in1, in2, in3);
+	}
+	
+	// copy the temporary output state_out into the bitsliced state state_bs
+	// to reflect the changes and prevent overwriting entries.
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+	{
+		state_bs[i] = state_out[i];
+	}
+}
+
+/*
+ * pbox_layer applies the permutation transformation. The bitsliced implementation of PRESENT
+ * allows for an extremely fast and simple permutation implementation.
+ * The pbox_layer no longer has to extract individual bits, therefore it is much faster.
+ * 
+ * It only computes the permuted position of the bit, and moves the whole state_bs entry into
+ * the permuted position. This permutes all 32 states at once.
+ */
+static void pbox_layer(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
+{
+	bs_reg_t state_out[CRYPTO_IN_SIZE_BIT] = { 0 };
+
+	for (uint8_t bit = 0; bit < CRYPTO_IN_SIZE_BIT; bit++)
+	{
+		uint8_t out = (bit / 4) + (bit % 4) * 16; // compute the permuted position
+		state_out[out] = state_bs[bit];
+	}
+
+	// copy the temporary output state_out into the bitsliced state state_bs
+	// to reflect the changes and prevent overwriting entries.
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+	{
+		state_bs[i] = state_out[i];
+	}
+}
+
+/*
+ * sbox_inv_layer undoes sbox_layer. It walks the state in the same chunks of 4 entries,
+ * but passes them through the inverse SBox functions sbox_inv0 ... sbox_inv3.
+ */
+static void sbox_inv_layer(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
+{
+	bs_reg_t state_out[CRYPTO_IN_SIZE_BIT] = { 0 };
+
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		bs_reg_t in0 = state_bs[i * 4 + 0];
+		bs_reg_t in1 = state_bs[i * 4 + 1];
+		bs_reg_t in2 = state_bs[i * 4 + 2];
+		bs_reg_t in3 = state_bs[i * 4 + 3];
+
+		state_out[i * 4 + 0] = sbox_inv0(in0, in1, in2, in3);
+		state_out[i * 4 + 1] = sbox_inv1(in0, in1, in2, in3);
+		state_out[i * 4 + 2] = sbox_inv2(in0, in1, in2, in3);
+		state_out[i * 4 + 3] = sbox_inv3(in0, in1, in2, in3);
+	}
+
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+	{
+		state_bs[i] = state_out[i];
+	}
+}
+
+/*
+ * pbox_inv_layer undoes pbox_layer. Instead of moving entry bit to its permuted position,
+ * it fetches the entry from the permuted position back into position bit.
+ */
+static void pbox_inv_layer(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
+{
+	bs_reg_t state_out[CRYPTO_IN_SIZE_BIT] = { 0 };
+
+	for (uint8_t bit = 0; bit < CRYPTO_IN_SIZE_BIT; bit++)
+	{
+		uint8_t out = (bit / 4) + (bit % 4) * 16; // compute the permuted position
+		state_out[bit] = state_bs[out];
+	}
+
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+	{
+		state_bs[i] = state_out[i];
+	}
+}
+
+/**
+ * Perform next key schedule step
+ * @param key Key register to be updated
+ * @param r Round counter
+ * @warning For correct function, has to be called with incremented r each time
+ * @note You are free to change or optimize this function
+ */
+static void update_round_key(uint8_t key[CRYPTO_KEY_SIZE], const uint8_t r)
+{
+	const uint8_t sbox[16] = {
+		0xC, 0x5, 0x6, 0xB, 0x9, 0x0, 0xA, 0xD, 0x3, 0xE, 0xF, 0x8, 0x4, 0x7, 0x1, 0x2,
+	};
+
+	uint8_t tmp = 0;
+	const uint8_t tmp2 = key[2];
+	const uint8_t tmp1 = key[1];
+	const uint8_t tmp0 = key[0];
+	
+	// rotate right by 19 bit
+	key[0] = key[2] >> 3 | key[3] << 5;
+	key[1] = key[3] >> 3 | key[4] << 5;
+	key[2] = key[4] >> 3 | key[5] << 5;
+	key[3] = key[5] >> 3 | key[6] << 5;
+	key[4] = key[6] >> 3 | key[7] << 5;
+	key[5] = key[7] >> 3 | key[8] << 5;
+	key[6] = key[8] >> 3 | key[9] << 5;
+	key[7] = key[9] >> 3 | tmp0 << 5;
+	key[8] = tmp0 >> 3   | tmp1 << 5;
+	key[9] = tmp1 >> 3   | tmp2 << 5;
+	
+	// perform sbox lookup on MSbits
+	tmp = sbox[key[9] >> 4];
+	key[9] &= 0x0F;
+	key[9] |= tmp << 4;
+	
+	// XOR round counter k19 ... k15
+	key[1] ^= r << 7;
+	key[2] ^= r >> 1;
+}
+
+void crypto_func(uint8_t pt[CRYPTO_IN_SIZE * BITSLICE_WIDTH], uint8_t key[CRYPTO_KEY_SIZE])
+{
+	// State buffer and additional backbuffer of same size
+	bs_reg_t state[CRYPTO_IN_SIZE_BIT];
+	bs_reg_t bb[CRYPTO_IN_SIZE_BIT];
+	
+	uint8_t round;
+	uint8_t i;
+	
+	// Bring into bitslicing form
+	enslice(pt, state);
+	
+	// PRESENT main code, nearly identical to the PRESENT paper
+	// although instead of the original state s, a bitsliced state is used
+	for(i = 1; i <= 31; i++)
+	{
+		add_round_key(state, key + 2);
+		sbox_layer(state);
+		pbox_layer(state);
+		update_round_key(key, i);
+	}
+	
+	add_round_key(state, key + 2);
+		
+	// Convert back to normal form
+	unslice(state, pt);
+}
+
+/**
+ * Expand a cipher key into all round keys
+ * @param ks Output: Round keys 1 ... 32
+ * @param key Input: 80-bit cipher key, left untouched
+ *
+ * Runs the same key schedule as crypto_func, but on a copy of the key, and keeps
+ * every round key (the upper 64 bits of the key register) so that the schedule
+ * can be reused for any number of batches and for decryption.
+ */
+void present_bs_expand_key(present_bs_key_t *ks, const uint8_t key[CRYPTO_KEY_SIZE])
+{
+	uint8_t k[CRYPTO_KEY_SIZE];
+	uint8_t i;
+
+	for (i = 0; i < CRYPTO_KEY_SIZE; i++)
+	{
+		k[i] = key[i];
+	}
+
+	for (i = 0; i <= PRESENT_BS_ROUNDS; i++)
+	{
+		for (uint8_t b = 0; b < CRYPTO_IN_SIZE; b++)
+		{
+			ks->rk[i][b] = k[b + 2];
+		}
+
+		update_round_key(k, i + 1);
+	}
+}
+
+/*
+ * encrypt_rounds runs rounds first ... first + count - 1 of PRESENT on a state that is
+ * already in bitsliced form. Round r adds round key r and applies the SBox and the
+ * permutation, except for the last round PRESENT_BS_ROUNDS, which only adds the final
+ * round key. All rounds 0 ... PRESENT_BS_ROUNDS together are one full encryption.
+ */
+static void encrypt_rounds(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], const present_bs_key_t *ks, uint8_t first, uint8_t count)
+{
+	for (uint8_t r = first; r < first + count; r++)
+	{
+		add_round_key(state_bs, ks->rk[r]);
+
+		if (r < PRESENT_BS_ROUNDS)
+		{
+			sbox_layer(state_bs);
+			pbox_layer(state_bs);
+		}
+	}
+}
+
+/*
+ * decrypt_rounds undoes the same rounds as encrypt_rounds, from the last one back
+ * to first, with the inverse layers.
+ */
+static void decrypt_rounds(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], const present_bs_key_t *ks, uint8_t first, uint8_t count)
+{
+	for (uint8_t r = first + count; r > first; r--)
+	{
+		if (r - 1 < PRESENT_BS_ROUNDS)
+		{
+			pbox_inv_layer(state_bs);
+			sbox_inv_layer(state_bs);
+		}
+
+		add_round_key(state_bs, ks->rk[r - 1]);
+	}
+}
+
+static void encrypt_sliced(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], const present_bs_key_t *ks)
+{
+	encrypt_rounds(state_bs, ks, 0, PRESENT_BS_ROUNDS + 1);
+}
+
+static void decrypt_sliced(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], const present_bs_key_t *ks)
+{
+	decrypt_rounds(state_bs, ks, 0, PRESENT_BS_ROUNDS + 1);
+}
+
+/**
+ * Encrypt one batch of BITSLICE_WIDTH blocks with an expanded key
+ * @param pt Input: plaintext batch, Output: ciphertext batch
+ * @param ks Expanded round keys
+ */
+void present_bs_encrypt_batch(uint8_t pt[PRESENT_BS_BATCH_SIZE], const present_bs_key_t *ks)
+{
+	bs_reg_t state[CRYPTO_IN_SIZE_BIT];
+
+	enslice(pt, state);
+	encrypt_sliced(state, ks);
+	unslice(state, pt);
+}
+
+/**
+ * Decrypt one batch of BITSLICE_WIDTH blocks with an expanded key
+ * @param ct Input: ciphertext batch, Output: plaintext batch
+ * @param ks Expanded round keys
+ */
+void present_bs_decrypt_batch(uint8_t ct[PRESENT_BS_BATCH_SIZE], const present_bs_key_t *ks)
+{
+	bs_reg_t state[CRYPTO_IN_SIZE_BIT];
+
+	enslice(ct, state);
+	decrypt_sliced(state, ks);
+	unslice(state, ct);
+}
+
+/**
+ * Bring a run of counter blocks into bitsliced form
+ * @param ctr Counter block of lane 0, lane l holds ctr + l
+ * @param state_bs Output: Bitsliced state
+ *
+ * When ctr is a multiple of BITSLICE_WIDTH, adding the lane index only touches the
+ * low log2(BITSLICE_WIDTH) bits, and those bits simply count through the lanes. The
+ * entries for them are fixed patterns (0xAAAAAAAA, 0xCCCCCCCC, ... for 32 lanes), and
+ * every higher entry is either all ones or all zeros, copied from ctr. This skips
+ * enslice completely. Any other ctr is written out in normal form and ensliced.
+ */
+static void enslice_ctr(uint64_t ctr, bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT])
+{
+	if (ctr % BITSLICE_WIDTH == 0)
+	{
+		for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+		{
+			bs_reg_t temp = 0;
+
+			if (((uint64_t)1 << i) < BITSLICE_WIDTH)
+			{
+				for (uint8_t lane = 0; lane < BITSLICE_WIDTH; lane++)
+				{
+					temp |= (bs_reg_t)((lane >> i) & 1) << lane;
+				}
+			}
+			else if ((ctr >> i) & 1)
+			{
+				temp = BS_INV;
+			}
+
+			state_bs[i] = temp;
+		}
+	}
+	else
+	{
+		uint8_t blocks[PRESENT_BS_BATCH_SIZE];
+
+		for (uint32_t lane = 0; lane < BITSLICE_WIDTH; lane++)
+		{
+			uint64_t v = ctr + lane;
+
+			for (uint8_t b = 0; b < CRYPTO_IN_SIZE; b++)
+			{
+				blocks[lane * CRYPTO_IN_SIZE + b] = (uint8_t)(v >> (b * 8));
+			}
+		}
+
+		enslice(blocks, state_bs);
+	}
+}
+
+/**
+ * Compute one batch of CTR keystream
+ * @param ks Expanded round keys
+ * @param ctr Counter block of the first lane
+ * @param stream Output: E(ctr), E(ctr + 1), ... E(ctr + BITSLICE_WIDTH - 1) in normal form
+ */
+void present_bs_ctr_keystream(const present_bs_key_t *ks, uint64_t ctr, uint8_t stream[PRESENT_BS_BATCH_SIZE])
+{
+	bs_reg_t state[CRYPTO_IN_SIZE_BIT];
+
+	enslice_ctr(ctr, state);
+	encrypt_sliced(state, ks);
+	unslice(state, stream);
+}
+
+/**
+ * Encrypt or decrypt a buffer in CTR mode
+ * @param ks Expanded round keys
+ * @param ctr Counter block of the first block of in, incremented as a 64-bit integer
+ * @param in Input buffer
+ * @param out Output buffer, may be the same as in
+ * @param len Length of the buffer in bytes, the last block may be partial
+ */
+void present_bs_ctr_xor(const present_bs_key_t *ks, uint64_t ctr, const uint8_t *in, uint8_t *out, size_t len)
+{
+	uint8_t stream[PRESENT_BS_BATCH_SIZE];
+
+	while (len)
+	{
+		size_t n = len < PRESENT_BS_BATCH_SIZE ? len : PRESENT_BS_BATCH_SIZE;
+
+		if (n == PRESENT_BS_BATCH_SIZE)
+		{
+			present_bs_ctr_keystream(ks, ctr, stream);
+		}
+		else
+		{
+			// last partial batch, only unslice the lanes that are needed
+			bs_reg_t state[CRYPTO_IN_SIZE_BIT];
+
+			enslice_ctr(ctr, state);
+			encrypt_sliced(state, ks);
+			unslice_lanes(state, lane_mask((uint32_t)((n + CRYPTO_IN_SIZE - 1) / CRYPTO_IN_SIZE)), stream);
+		}
+
+		for (size_t i = 0; i < n; i++)
+		{
+			out[i] = in[i] ^ stream[i];
+		}
+
+		ctr += BITSLICE_WIDTH;
+		in += n;
+		out += n;
+		len -= n;
+	}
+}
+
+/**
+ * Encrypt an array of 64-bit integers, e.g. to turn sequential IDs into tokens
+ * @param ks Expanded round keys
+ * @param v Input: plain values, Output: encrypted values
+ * @param n Number of values, any count, the last batch may be partial
+ *
+ * E(x) is the same as encrypting the little endian encoding of x with crypto_func.
+ */
+void present_bs_encrypt_u64(const present_bs_key_t *ks, uint64_t *v, size_t n)
+{
+	bs_reg_t state[CRYPTO_IN_SIZE_BIT];
+
+	while (n)
+	{
+		uint32_t lanes = n < BITSLICE_WIDTH ? (uint32_t)n : BITSLICE_WIDTH;
+
+		enslice_u64(v, lanes, state);
+		encrypt_sliced(state, ks);
+		unslice_u64(state, v, lanes);
+
+		v += lanes;
+		n -= lanes;
+	}
+}
+
+/**
+ * Decrypt an array of 64-bit integers, the inverse of present_bs_encrypt_u64
+ * @param ks Expanded round keys
+ * @param v Input: encrypted values, Output: plain values
+ * @param n Number of values
+ */
+void present_bs_decrypt_u64(const present_bs_key_t *ks, uint64_t *v, size_t n)
+{
+	bs_reg_t state[CRYPTO_IN_SIZE_BIT];
+
+	while (n)
+	{
+		uint32_t lanes = n < BITSLICE_WIDTH ? (uint32_t)n : BITSLICE_WIDTH;
+
+		enslice_u64(v, lanes, state);
+		decrypt_sliced(state, ks);
+		unslice_u64(state, v, lanes);
+
+		v += lanes;
+		n -= lanes;
+	}
+}
+
+/*
+ * The present_bs_state functions give access to the bitsliced state itself, so that
+ * several operations can be chained on one batch with a single enslice at the start
+ * and a single unslice at the end.
+ */
+void present_bs_state_load(present_bs_state_t *st, const uint8_t pt[PRESENT_BS_BATCH_SIZE])
+{
+	enslice(pt, st->s);
+}
+
+void present_bs_state_load_u64(present_bs_state_t *st, const uint64_t *v, uint32_t n)
+{
+	enslice_u64(v, n, st->s);
+}
+
+void present_bs_state_store(const present_bs_state_t *st, uint8_t pt[PRESENT_BS_BATCH_SIZE])
+{
+	unslice(st->s, pt);
+}
+
+void present_bs_state_store_u64(const present_bs_state_t *st, uint64_t *v, uint32_t n)
+{
+	present_bs_state_t tmp = *st; // unslice_u64 transposes in place
+
+	unslice_u64(tmp.s, v, n);
+}
+
+// present_bs_state_counter loads the counter blocks ctr ... ctr + BITSLICE_WIDTH - 1
+void present_bs_state_counter(present_bs_state_t *st, uint64_t ctr)
+{
+	enslice_ctr(ctr, st->s);
+}
+
+void present_bs_state_encrypt(present_bs_state_t *st, const present_bs_key_t *ks, uint8_t first, uint8_t count)
+{
+	encrypt_rounds(st->s, ks, first, count);
+}
+
+void present_bs_state_decrypt(present_bs_state_t *st, const present_bs_key_t *ks, uint8_t first, uint8_t count)
+{
+	decrypt_rounds(st->s, ks, first, count);
+}
+
+void present_bs_state_xor(present_bs_state_t *dst, const present_bs_state_t *src)
+{
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+	{
+		dst->s[i] ^= src->s[i];
+	}
+}
+
+/*
+ * present_bs_state_compare returns a lane mask with bit l set if lane l holds the
+ * same block in a and b. Differences of all entries are ORed together, so a lane
+ * is equal if its bit stays 0 in every entry.
+ */
+bs_reg_t present_bs_state_compare(const present_bs_state_t *a, const present_bs_state_t *b)
+{
+	bs_reg_t diff = 0;
+
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+	{
+		diff |= a->s[i] ^ b->s[i];
+	}
+
+	return ~diff;
+}
+
+/*
+ * slice_round_key turns a round key into its bitsliced form, one all ones or all
+ * zeros entry per key bit, exactly the values add_round_key XORs in.
+ */
+static void slice_round_key(const uint8_t roundkey[CRYPTO_IN_SIZE], bs_reg_t key_bs[CRYPTO_IN_SIZE_BIT])
+{
+	for (uint8_t bit = 0; bit < CRYPTO_IN_SIZE_BIT; bit++)
+	{
+		uint8_t key_bit = (roundkey[bit / CRYPTO_IN_SIZE] >> (bit % CRYPTO_IN_SIZE)) & 1;
+		key_bs[bit] = key_bit ? BS_INV : 0;
+	}
+}
+
+/*
+ * bulk_rounds runs the whole cipher on PRESENT_BS_BULK_K sliced batches round by
+ * round, instead of batch by batch. Every round key is sliced once and then used for
+ * all batches, and the SBox circuits of the batches do not depend on each other, so
+ * the core can overlap them.
+ */
+static void bulk_rounds(bs_reg_t states[PRESENT_BS_BULK_K][CRYPTO_IN_SIZE_BIT], const present_bs_key_t *ks, int decrypt)
+{
+	bs_reg_t key_bs[CRYPTO_IN_SIZE_BIT];
+	uint8_t k;
+
+	for (uint8_t i = 0; i <= PRESENT_BS_ROUNDS; i++)
+	{
+		uint8_t r = decrypt ? PRESENT_BS_ROUNDS - i : i;
+
+		slice_round_key(ks->rk[r], key_bs);
+
+		for (k = 0; k < PRESENT_BS_BULK_K; k++)
+		{
+			if (decrypt && r < PRESENT_BS_ROUNDS)
+			{
+				pbox_inv_layer(states[k]);
+				sbox_inv_layer(states[k]);
+			}
+
+			for (uint8_t bit = 0; bit < CRYPTO_IN_SIZE_BIT; bit++)
+			{
+				states[k][bit] ^= key_bs[bit];
+			}
+
+			if (!decrypt && r < PRESENT_BS_ROUNDS)
+			{
+				sbox_layer(states[k]);
+				pbox_layer(states[k]);
+			}
+		}
+	}
+}
+
+/*
+ * blocks_crypt processes whole batches in place and the last, partial batch with
+ * enslice_lanes and unslice_lanes, so no staging buffer is needed for it and the
+ * work for the missing blocks is skipped. As long as there are PRESENT_BS_BULK_K
+ * full batches left, they go through bulk_rounds together.
+ *
+ * Every batch is decrypted under dec and then encrypted under enc while it stays
+ * in sliced form, either schedule may be 0 to skip that half. With both given this
+ * re-encrypts from one key to the other with a single enslice and unslice.
+ */
+static void blocks_crypt(const present_bs_key_t *dec, const present_bs_key_t *enc, uint8_t *blocks, size_t n)
+{
+	bs_reg_t states[PRESENT_BS_BULK_K][CRYPTO_IN_SIZE_BIT];
+	bs_reg_t *state = states[0];
+	uint8_t k;
+
+	for (; n >= (size_t)PRESENT_BS_BULK_K * BITSLICE_WIDTH; n -= (size_t)PRESENT_BS_BULK_K * BITSLICE_WIDTH)
+	{
+		for (k = 0; k < PRESENT_BS_BULK_K; k++)
+		{
+			enslice(blocks + k * PRESENT_BS_BATCH_SIZE, states[k]);
+		}
+
+		if (dec)
+		{
+			bulk_rounds(states, dec, 1);
+		}
+		if (enc)
+		{
+			bulk_rounds(states, enc, 0);
+		}
+
+		for (k = 0; k < PRESENT_BS_BULK_K; k++)
+		{
+			unslice(states[k], blocks + k * PRESENT_BS_BATCH_SIZE);
+		}
+
+		blocks += PRESENT_BS_BULK_K * PRESENT_BS_BATCH_SIZE;
+	}
+
+	while (n)
+	{
+		uint32_t lanes = n < BITSLICE_WIDTH ? (uint32_t)n : BITSLICE_WIDTH;
+
+		if (lanes == BITSLICE_WIDTH)
+		{
+			enslice(blocks, state);
+		}
+		else
+		{
+			enslice_lanes(blocks, lanes, state);
+		}
+
+		if (dec)
+		{
+			decrypt_sliced(state, dec);
+		}
+		if (enc)
+		{
+			encrypt_sliced(state, enc);
+		}
+
+		if (lanes == BITSLICE_WIDTH)
+		{
+			unslice(state, blocks);
+		}
+		else
+		{
+			unslice_lanes(state, lane_mask(lanes), blocks);
+		}
+
+		blocks += lanes * CRYPTO_IN_SIZE;
+		n -= lanes;
+	}
+}
+
+/**
+ * Encrypt any number of blocks in ECB mode
+ * @param ks Expanded round keys
+ * @param blocks Input: n plaintext blocks, Output: n ciphertext blocks
+ * @param n Number of blocks
+ */
+void present_bs_encrypt_blocks(const present_bs_key_t *ks, uint8_t *blocks, size_t n)
+{
+	blocks_crypt(0, ks, blocks, n);
+}
+
+void present_bs_decrypt_blocks(const present_bs_key_t *ks, uint8_t *blocks, size_t n)
+{
+	blocks_crypt(ks, 0, blocks, n);
+}
+
+/**
+ * Re-encrypt ECB blocks from one key to another in a single pass
+ * @param old_ks Expanded round keys the blocks are encrypted with
+ * @param new_ks Expanded round keys to encrypt with instead
+ * @param blocks Input: n blocks under old_ks, Output: the same blocks under new_ks
+ * @param n Number of blocks
+ *
+ * Same result as present_bs_decrypt_blocks followed by present_bs_encrypt_blocks,
+ * but the plaintext never leaves sliced form, so every batch is transposed only
+ * once in each direction and the buffer is read and written only once.
+ */
+void present_bs_reencrypt_blocks(const present_bs_key_t *old_ks, const present_bs_key_t *new_ks, uint8_t *blocks, size_t n)
+{
+	blocks_crypt(old_ks, new_ks, blocks, n);
+}
+
+/**
+ * Move a CTR encrypted buffer from one key and counter to another in a single pass
+ * @param old_ks Expanded round keys of the current encryption
+ * @param old_ctr Counter block the current encryption of in starts at
+ * @param new_ks Expanded round keys of the new encryption
+ * @param new_ctr Counter block the new encryption starts at
+ * @param in Input buffer
+ * @param out Output buffer, may be the same as in
+ * @param len Length of the buffer in bytes, the last block may be partial
+ *
+ * Both keystreams are XORed while they are still sliced, so only their sum is
+ * unsliced and the data is touched once, instead of two present_bs_ctr_xor passes.
+ */
+void present_bs_ctr_rekey(const present_bs_key_t *old_ks, uint64_t old_ctr, const present_bs_key_t *new_ks,
+	uint64_t new_ctr, const uint8_t *in, uint8_t *out, size_t len)
+{
+	bs_reg_t state[CRYPTO_IN_SIZE_BIT];
+	bs_reg_t other[CRYPTO_IN_SIZE_BIT];
+	uint8_t stream[PRESENT_BS_BATCH_SIZE];
+
+	while (len)
+	{
+		size_t n = len < PRESENT_BS_BATCH_SIZE ? len : PRESENT_BS_BATCH_SIZE;
+
+		enslice_ctr(old_ctr, state);
+		encrypt_sliced(state, old_ks);
+		enslice_ctr(new_ctr, other);
+		encrypt_sliced(other, new_ks);
+
+		for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+		{
+			state[i] ^= other[i];
+		}
+
+		if (n == PRESENT_BS_BATCH_SIZE)
+		{
+			unslice(state, stream);
+		}
+		else
+		{
+			unslice_lanes(state, lane_mask((uint32_t)((n + CRYPTO_IN_SIZE - 1) / CRYPTO_IN_SIZE)), stream);
+		}
+
+		for (size_t i = 0; i < n; i++)
+		{
+			out[i] = in[i] ^ stream[i];
+		}
+
+		old_ctr += BITSLICE_WIDTH;
+		new_ctr += BITSLICE_WIDTH;
+		in += n;
+		out += n;
+		len -= n;
+	}
+}
+
+// present_bs_state_load_lanes loads n blocks, the remaining lanes are set to 0
+void present_bs_state_load_lanes(present_bs_state_t *st, const uint8_t *pt, uint32_t n)
+{
+	enslice_lanes(pt, n, st->s);
+}
+
+// present_bs_state_extract stores the lanes in mask, packed in lane order
+void present_bs_state_extract(const present_bs_state_t *st, bs_reg_t mask, uint8_t *out)
+{
+	unslice_lanes(st->s, mask, out);
+}
+
+/*
+ * present_bs_state_extract_bits returns count bits of the block in lane, starting at
+ * bit first, e.g. one nibble of a result or a truncated tag. Only those count
+ * entries are read.
+ */
+uint64_t present_bs_state_extract_bits(const present_bs_state_t *st, uint32_t lane, uint8_t first, uint8_t count)
+{
+	uint64_t v = 0;
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		v |= (uint64_t)((st->s[first + i] >> lane) & 1) << i;
+	}
+
+	return v;
+}
+
+/**
+ * Bring one key per lane into bitsliced form
+ * @param key Output: Sliced key register
+ * @param keys n keys of CRYPTO_KEY_SIZE bytes, key l goes to lane l
+ * @param n Number of keys, the remaining lanes get the all zero key
+ */
+void present_bs_lanekey_load(present_bs_lanekey_t *key, const uint8_t *keys, uint32_t n)
+{
+	for (uint8_t bit = 0; bit < PRESENT_BS_KEY_BITS; bit++)
+	{
+		bs_reg_t temp = 0;
+
+		for (uint32_t lane = 0; lane < n; lane++)
+		{
+			temp |= (bs_reg_t)((keys[lane * CRYPTO_KEY_SIZE + bit / 8] >> (bit % 8)) & 1) << lane;
+		}
+
+		key->k[bit] = temp;
+	}
+}
+
+/*
+ * lanekey_update runs update_round_key on a sliced key register for all lanes at
+ * once. The register is used as a ring: key bit j lives in k[(j + *off) % 80], so the
+ * rotation by 19 bits only moves the offset. The SBox on the top nibble reuses the
+ * sbox0 ... sbox3 circuits, and the round counter is a constant XOR on bits 15 ... 19.
+ */
+static void lanekey_update(bs_reg_t k[PRESENT_BS_KEY_BITS], uint8_t *off, uint8_t r)
+{
+	uint8_t idx[4];
+
+	*off = (uint8_t)((*off + 19) % PRESENT_BS_KEY_BITS);
+
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		idx[i] = (uint8_t)((76 + i + *off) % PRESENT_BS_KEY_BITS);
+	}
+
+	bs_reg_t x0 = k[idx[0]], x1 = k[idx[1]], x2 = k[idx[2]], x3 = k[idx[3]];
+	k[idx[0]] = sbox0(x0, x1, x2, x3);
+	k[idx[1]] = sbox1(x0, x1, x2, x3);
+	k[idx[2]] = sbox2(x0, x1, x2, x3);
+	k[idx[3]] = sbox3(x0, x1, x2, x3);
+
+	for (uint8_t i = 0; i < 5; i++)
+	{
+		if ((r >> i) & 1)
+		{
+			k[(15 + i + *off) % PRESENT_BS_KEY_BITS] ^= BS_INV;
+		}
+	}
+}
+
+// lanekey_add XORs the round key, bits 16 ... 79 of the key register, into the state
+static void lanekey_add(bs_reg_t state_bs[CRYPTO_IN_SIZE_BIT], const bs_reg_t k[PRESENT_BS_KEY_BITS], uint8_t off)
+{
+	uint8_t j = (uint8_t)((16 + off) % PRESENT_BS_KEY_BITS);
+
+	for (uint8_t bit = 0; bit < CRYPTO_IN_SIZE_BIT; bit++)
+	{
+		state_bs[bit] ^= k[j];
+
+		if (++j == PRESENT_BS_KEY_BITS)
+		{
+			j = 0;
+		}
+	}
+}
+
+/**
+ * Encrypt a sliced state with a different key in every lane
+ * @param st Input: plaintext batch, Output: ciphertext batch
+ * @param key Sliced key register, left untouched
+ *
+ * Runs the key schedule in the sliced domain next to the rounds, the same way
+ * crypto_func does it, so lanes never need an expanded schedule of their own. This
+ * is what makes it cheap to re-key every lane after every block.
+ */
+void present_bs_state_encrypt_lanekey(present_bs_state_t *st, const present_bs_lanekey_t *key)
+{
+	bs_reg_t k[PRESENT_BS_KEY_BITS];
+	uint8_t off = 0;
+
+	for (uint8_t i = 0; i < PRESENT_BS_KEY_BITS; i++)
+	{
+		k[i] = key->k[i];
+	}
+
+	for (uint8_t r = 1; r <= PRESENT_BS_ROUNDS; r++)
+	{
+		lanekey_add(st->s, k, off);
+		sbox_layer(st->s);
+		pbox_layer(st->s);
+		lanekey_update(k, &off, r);
+	}
+
+	lanekey_add(st->s, k, off);
+}
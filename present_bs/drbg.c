@@ -0,0 +1,183 @@
+#include "drbg.h"
+#include "util.h"
+
+/*
+ * drbg_update is the CTR_DRBG update function. It encrypts V, V + 1 and V + 2,
+ * XORs the first PRESENT_BS_DRBG_SEED_SIZE bytes with the provided data (if any),
+ * and takes the new key and the new V from the result. All three blocks come out
+ * of one keystream batch.
+ *
+ * Unlike CTR_DRBG, V is rounded down to a multiple of BITSLICE_WIDTH and only ever
+ * advanced by whole batches, so every batch starts on a lane boundary and takes the
+ * fast counter path of present_bs_ctr_keystream instead of a full enslice.
+ */
+static void drbg_update(present_bs_drbg_t *ctx, const uint8_t data[PRESENT_BS_DRBG_SEED_SIZE])
+{
+	uint8_t temp[PRESENT_BS_BATCH_SIZE];
+	uint8_t i;
+
+	present_bs_ctr_keystream(&ctx->ks, ctx->v, temp);
+
+	if (data)
+	{
+		for (i = 0; i < PRESENT_BS_DRBG_SEED_SIZE; i++)
+		{
+			temp[i] ^= data[i];
+		}
+	}
+
+	present_bs_expand_key(&ctx->ks, temp);
+
+	ctx->v = get64(temp + CRYPTO_KEY_SIZE) & ~(uint64_t)(BITSLICE_WIDTH - 1);
+}
+
+static int fill_trylock(present_bs_drbg_t *ctx)
+{
+	return !__atomic_exchange_n(&ctx->filling, 1, __ATOMIC_ACQUIRE);
+}
+
+static void fill_lock(present_bs_drbg_t *ctx)
+{
+	while (!fill_trylock(ctx))
+	{
+	}
+}
+
+static void fill_unlock(present_bs_drbg_t *ctx)
+{
+	__atomic_store_n(&ctx->filling, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * present_bs_drbg_init instantiates the generator from seed material, starting from
+ * an all zero key and V like CTR_DRBG without a derivation function. Both buffers
+ * start out empty.
+ */
+void present_bs_drbg_init(present_bs_drbg_t *ctx, const uint8_t seed[PRESENT_BS_DRBG_SEED_SIZE])
+{
+	const uint8_t zero[CRYPTO_KEY_SIZE] = { 0 };
+
+	present_bs_expand_key(&ctx->ks, zero);
+	ctx->v = 0;
+	ctx->front = 0;
+	ctx->filling = 0;
+	present_bs_drbg_reseed(ctx, seed);
+}
+
+/*
+ * present_bs_drbg_reseed mixes fresh seed material into the state. Output that was
+ * generated ahead under the old state is thrown away.
+ */
+void present_bs_drbg_reseed(present_bs_drbg_t *ctx, const uint8_t seed[PRESENT_BS_DRBG_SEED_SIZE])
+{
+	fill_lock(ctx);
+	drbg_update(ctx, seed);
+	ctx->refills = 0;
+	ctx->pos = PRESENT_BS_DRBG_BUF_SIZE;
+	__atomic_store_n(&ctx->back_ready, 0, __ATOMIC_RELEASE);
+	fill_unlock(ctx);
+}
+
+/*
+ * refill_locked fills the back buffer with PRESENT_BS_DRBG_BATCHES batches of
+ * keystream and then updates key and V, so output already handed out cannot be
+ * recomputed from a later state. Unlike CTR_DRBG, the update runs once per buffer
+ * and not once per request. Nothing happens when the back buffer is still full or
+ * the reseed interval is used up. Called with the filling flag held.
+ */
+static void refill_locked(present_bs_drbg_t *ctx)
+{
+	if (__atomic_load_n(&ctx->back_ready, __ATOMIC_ACQUIRE) || ctx->refills >= PRESENT_BS_DRBG_RESEED_INTERVAL)
+	{
+		return;
+	}
+
+	// front was last written before back_ready was cleared, so the acquire above covers it
+	uint8_t *buf = ctx->buf[ctx->front ^ 1];
+
+	for (uint32_t b = 0; b < PRESENT_BS_DRBG_BATCHES; b++)
+	{
+		present_bs_ctr_keystream(&ctx->ks, ctx->v, buf + b * PRESENT_BS_BATCH_SIZE);
+		ctx->v += BITSLICE_WIDTH;
+	}
+
+	drbg_update(ctx, 0);
+	ctx->refills++;
+	__atomic_store_n(&ctx->back_ready, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * present_bs_drbg_refill keeps the next buffer ready ahead of time, from an idle
+ * loop or on another core. It returns right away if the back buffer is full or the
+ * request path is filling it itself.
+ */
+void present_bs_drbg_refill(present_bs_drbg_t *ctx)
+{
+	if (__atomic_load_n(&ctx->back_ready, __ATOMIC_ACQUIRE) || !fill_trylock(ctx))
+	{
+		return;
+	}
+
+	refill_locked(ctx);
+	fill_unlock(ctx);
+}
+
+/*
+ * present_bs_drbg_generate copies len bytes from the front buffer. When the front
+ * buffer runs empty the buffers are swapped, and if the back buffer was not refilled
+ * ahead of time, it is filled now. Returns 0 on success and -1 when the request
+ * would need more refills than the reseed interval has left, in which case out is
+ * left untouched and the generator has to be reseeded first.
+ */
+int present_bs_drbg_generate(present_bs_drbg_t *ctx, uint8_t *out, size_t len)
+{
+	size_t left = PRESENT_BS_DRBG_BUF_SIZE - ctx->pos;
+
+	if (len > left)
+	{
+		// one refill per buffer still to come, a ready back buffer is already counted
+		uint64_t buffers = (len - left + PRESENT_BS_DRBG_BUF_SIZE - 1) / PRESENT_BS_DRBG_BUF_SIZE;
+
+		fill_lock(ctx);
+		uint64_t needed = ctx->refills + buffers - __atomic_load_n(&ctx->back_ready, __ATOMIC_ACQUIRE);
+		fill_unlock(ctx);
+
+		if (needed > PRESENT_BS_DRBG_RESEED_INTERVAL)
+		{
+			return -1;
+		}
+	}
+
+	while (len)
+	{
+		if (ctx->pos == PRESENT_BS_DRBG_BUF_SIZE)
+		{
+			while (!__atomic_load_n(&ctx->back_ready, __ATOMIC_ACQUIRE))
+			{
+				fill_lock(ctx);
+				refill_locked(ctx);
+				fill_unlock(ctx);
+			}
+
+			ctx->front ^= 1;
+			ctx->pos = 0;
+			__atomic_store_n(&ctx->back_ready, 0, __ATOMIC_RELEASE);
+		}
+
+		uint8_t *buf = ctx->buf[ctx->front];
+		size_t n = PRESENT_BS_DRBG_BUF_SIZE - ctx->pos;
+		n = len < n ? len : n;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			out[i] = buf[ctx->pos + i];
+			buf[ctx->pos + i] = 0; // do not keep handed out bytes around
+		}
+
+		ctx->pos += n;
+		out += n;
+		len -= n;
+	}
+
+	return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef PRESENT_BS_DRBG_H
+#define PRESENT_BS_DRBG_H
+
+#include "present_bs.h"
+
+// Length of seed material and additional input: one key plus one block
+#define PRESENT_BS_DRBG_SEED_SIZE (CRYPTO_KEY_SIZE + CRYPTO_IN_SIZE)
+
+// Batches of keystream per buffer, there is a front and a back buffer
+#ifndef PRESENT_BS_DRBG_BATCHES
+#define PRESENT_BS_DRBG_BATCHES 4
+#endif
+
+#define PRESENT_BS_DRBG_BUF_SIZE (PRESENT_BS_DRBG_BATCHES * PRESENT_BS_BATCH_SIZE)
+
+// Buffer refills allowed before present_bs_drbg_generate asks for a reseed
+#ifndef PRESENT_BS_DRBG_RESEED_INTERVAL
+#define PRESENT_BS_DRBG_RESEED_INTERVAL (1ul << 20)
+#endif
+
+/*
+ * CTR_DRBG style generator state. Every instance is independent, so each thread
+ * or core can own one and no locking is needed.
+ *
+ * present_bs_drbg_refill may also run on another core or thread than the one that
+ * calls generate and reseed, to keep the back buffer ready off the request path.
+ * Key, V, the refill count and the back buffer are only touched with the filling
+ * flag held, and back_ready hands the back buffer over with release and acquire.
+ */
+typedef struct
+{
+	present_bs_key_t ks;
+	uint64_t v;
+	uint32_t refills;
+	uint8_t buf[2][PRESENT_BS_DRBG_BUF_SIZE];
+	uint32_t pos;
+	uint8_t front;
+	uint8_t back_ready;
+	uint8_t filling;
+} present_bs_drbg_t;
+
+void present_bs_drbg_init(present_bs_drbg_t *ctx, const uint8_t seed[PRESENT_BS_DRBG_SEED_SIZE]);
+void present_bs_drbg_reseed(present_bs_drbg_t *ctx, const uint8_t seed[PRESENT_BS_DRBG_SEED_SIZE]);
+void present_bs_drbg_refill(present_bs_drbg_t *ctx);
+int present_bs_drbg_generate(present_bs_drbg_t *ctx, uint8_t *out, size_t len);
+
+#endif
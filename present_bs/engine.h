@@ -0,0 +1,75 @@
+#ifndef PRESENT_BS_ENGINE_H
+#define PRESENT_BS_ENGINE_H
+
+#include "crypto.h"
+
+/*
+ * Cipher pieces shared by the x86 host engines in present_nibble, present_il and
+ * present_avx2. Internal, every engine that includes this gets its own copy.
+ */
+
+static const uint8_t sbox[16] = {
+	0xC, 0x5, 0x6, 0xB, 0x9, 0x0, 0xA, 0xD, 0x3, 0xE, 0xF, 0x8, 0x4, 0x7, 0x1, 0x2,
+};
+
+/**
+ * Perform next key schedule step
+ * @param key Key register to be updated
+ * @param r Round counter
+ * @warning For correct function, has to be called with incremented r each time
+ */
+static inline void update_round_key(uint8_t key[CRYPTO_KEY_SIZE], const uint8_t r)
+{
+	uint8_t tmp = 0;
+	const uint8_t tmp2 = key[2];
+	const uint8_t tmp1 = key[1];
+	const uint8_t tmp0 = key[0];
+
+	// rotate right by 19 bit
+	key[0] = key[2] >> 3 | key[3] << 5;
+	key[1] = key[3] >> 3 | key[4] << 5;
+	key[2] = key[4] >> 3 | key[5] << 5;
+	key[3] = key[5] >> 3 | key[6] << 5;
+	key[4] = key[6] >> 3 | key[7] << 5;
+	key[5] = key[7] >> 3 | key[8] << 5;
+	key[6] = key[8] >> 3 | key[9] << 5;
+	key[7] = key[9] >> 3 | tmp0 << 5;
+	key[8] = tmp0 >> 3   | tmp1 << 5;
+	key[9] = tmp1 >> 3   | tmp2 << 5;
+
+	// perform sbox lookup on MSbits
+	tmp = sbox[key[9] >> 4];
+	key[9] &= 0x0F;
+	key[9] |= tmp << 4;
+
+	// XOR round counter k19 ... k15
+	key[1] ^= r << 7;
+	key[2] ^= r >> 1;
+}
+
+/*
+ * sp_init fills the tables of the table engines: sp[k][v] is the result of the SBox
+ * and the permutation for a state that is 0 except for byte k, which is v. As both
+ * layers work on each byte independently (the permutation only moves bits), a full
+ * round is the XOR of eight lookups.
+ */
+static inline void sp_init(uint64_t sp[8][256])
+{
+	for (uint8_t k = 0; k < 8; k++)
+	{
+		for (uint32_t v = 0; v < 256; v++)
+		{
+			uint64_t s = (uint64_t)(sbox[v & 0xF] | (sbox[v >> 4] << 4)) << (k * 8);
+			uint64_t out = 0;
+
+			for (uint8_t b = 0; b < 64; b++)
+			{
+				out |= ((s >> b) & 1) << ((b / 4) + (b % 4) * 16);
+			}
+
+			sp[k][v] = out;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "fpe.h"
+
+void present_bs_fpe_init(present_bs_fpe_t *ctx, const present_bs_key_t *ks, uint64_t n)
+{
+	uint8_t bits = 0;
+
+	while (bits < 64 && ((n - 1) >> bits))
+	{
+		bits++;
+	}
+
+	// the two halves need at least one bit each and have to be the same size
+	bits = bits < 2 ? 2 : bits + (bits & 1);
+
+	ctx->ks = ks;
+	ctx->n = n;
+	ctx->half_bits = bits / 2;
+}
+
+/*
+ * feistel runs one full pass of the Feistel network over the first lanes values.
+ * The round function input of every lane is the round number and the half width in
+ * the top bytes and the right half below, so all lanes of one round go through a
+ * single bitsliced call. The output is cut down to the half width again.
+ */
+static void feistel(const present_bs_fpe_t *ctx, uint64_t v[BITSLICE_WIDTH], uint32_t lanes, int decrypt)
+{
+	const uint8_t h = ctx->half_bits;
+	const uint64_t mask = ((uint64_t)1 << h) - 1;
+	uint64_t l[BITSLICE_WIDTH];
+	uint64_t r[BITSLICE_WIDTH];
+	uint64_t f[BITSLICE_WIDTH];
+	uint32_t i;
+
+	for (i = 0; i < lanes; i++)
+	{
+		l[i] = v[i] >> h;
+		r[i] = v[i] & mask;
+	}
+
+	for (uint8_t round = 0; round < PRESENT_BS_FPE_ROUNDS; round++)
+	{
+		uint8_t rc = decrypt ? PRESENT_BS_FPE_ROUNDS - 1 - round : round;
+		uint64_t *in = decrypt ? l : r;
+		uint64_t *out = decrypt ? r : l;
+
+		for (i = 0; i < lanes; i++)
+		{
+			f[i] = ((uint64_t)rc << 56) | ((uint64_t)h << 48) | in[i];
+		}
+
+		present_bs_encrypt_u64(ctx->ks, f, lanes);
+
+		// out ^= F(in), then the halves swap roles for the next round
+		for (i = 0; i < lanes; i++)
+		{
+			uint64_t t = out[i] ^ (f[i] & mask);
+			out[i] = in[i];
+			in[i] = t;
+		}
+	}
+
+	for (i = 0; i < lanes; i++)
+	{
+		v[i] = (l[i] << h) | r[i];
+	}
+}
+
+/*
+ * fpe_walk is the batched cycle walking engine. Every lane holds a value together
+ * with the index of the input it belongs to. After each Feistel pass, lanes whose
+ * value is inside the range are done: the value is written to its output slot and
+ * the lane is refilled with the next input. Lanes that are still outside the range
+ * stay for another pass. Finished lanes without a replacement are removed by moving
+ * the last lane into their place, so the active lanes are always packed at the front.
+ */
+static void fpe_walk(const present_bs_fpe_t *ctx, const uint64_t *in, uint64_t *out, size_t count, int decrypt)
+{
+	uint64_t v[BITSLICE_WIDTH];
+	size_t idx[BITSLICE_WIDTH];
+	uint32_t lanes = 0;
+	size_t next = 0;
+
+	while (lanes < BITSLICE_WIDTH && next < count)
+	{
+		idx[lanes] = next;
+		v[lanes++] = in[next++];
+	}
+
+	while (lanes)
+	{
+		feistel(ctx, v, lanes, decrypt);
+
+		for (uint32_t i = 0; i < lanes; )
+		{
+			if (v[i] >= ctx->n)
+			{
+				i++;
+				continue;
+			}
+
+			out[idx[i]] = v[i];
+
+			if (next < count)
+			{
+				idx[i] = next;
+				v[i++] = in[next++];
+			}
+			else
+			{
+				lanes--;
+				idx[i] = idx[lanes];
+				v[i] = v[lanes];
+			}
+		}
+	}
+}
+
+/*
+ * present_bs_fpe_encrypt permutes count values, each of which has to be below n.
+ * in and out may be the same array.
+ */
+void present_bs_fpe_encrypt(const present_bs_fpe_t *ctx, const uint64_t *in, uint64_t *out, size_t count)
+{
+	fpe_walk(ctx, in, out, count, 0);
+}
+
+void present_bs_fpe_decrypt(const present_bs_fpe_t *ctx, const uint64_t *in, uint64_t *out, size_t count)
+{
+	fpe_walk(ctx, in, out, count, 1);
+}
@@ -0,0 +1,27 @@
+#ifndef PRESENT_BS_FPE_H
+#define PRESENT_BS_FPE_H
+
+#include "present_bs.h"
+
+// Feistel rounds per pass over the 2^(2 * half_bits) domain
+#define PRESENT_BS_FPE_ROUNDS 10
+
+/*
+ * Format preserving permutation of the integers 0 ... n - 1 for any n >= 1, e.g.
+ * account numbers below 10^12. A balanced Feistel network with PRESENT as round
+ * function permutes the smallest even bit width domain that covers n, which is
+ * less than 4n, and values that land outside the range are walked on until they
+ * fall back into it.
+ */
+typedef struct
+{
+	const present_bs_key_t *ks;
+	uint64_t n;
+	uint8_t half_bits;
+} present_bs_fpe_t;
+
+void present_bs_fpe_init(present_bs_fpe_t *ctx, const present_bs_key_t *ks, uint64_t n);
+void present_bs_fpe_encrypt(const present_bs_fpe_t *ctx, const uint64_t *in, uint64_t *out, size_t count);
+void present_bs_fpe_decrypt(const present_bs_fpe_t *ctx, const uint64_t *in, uint64_t *out, size_t count);
+
+#endif
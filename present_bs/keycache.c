@@ -0,0 +1,257 @@
+#include "keycache.h"
+#include "util.h"
+
+#define NONE 0xFFFFFFFFu
+
+static void lock_shard(present_bs_keycache_t *cache, uint32_t s)
+{
+	if (cache->lock)
+	{
+		cache->lock(cache->lock_arg, s);
+	}
+}
+
+static void unlock_shard(present_bs_keycache_t *cache, uint32_t s)
+{
+	if (cache->unlock)
+	{
+		cache->unlock(cache->lock_arg, s);
+	}
+}
+
+/*
+ * present_bs_keycache_init splits capacity entries and nbuckets hash buckets evenly
+ * between the shards. Returns -1 if a shard would get no entry or no bucket.
+ */
+int present_bs_keycache_init(present_bs_keycache_t *cache, present_bs_keycache_entry_t *entries, uint32_t capacity,
+	uint32_t *buckets, uint32_t nbuckets, void (*lock)(void *, uint32_t), void (*unlock)(void *, uint32_t), void *lock_arg)
+{
+	uint32_t per_entries = capacity / PRESENT_BS_KEYCACHE_SHARDS;
+	uint32_t per_buckets = nbuckets / PRESENT_BS_KEYCACHE_SHARDS;
+
+	if (per_entries == 0 || per_buckets == 0)
+	{
+		return -1;
+	}
+
+	for (uint32_t s = 0; s < PRESENT_BS_KEYCACHE_SHARDS; s++)
+	{
+		present_bs_keycache_shard_t *sh = &cache->shards[s];
+
+		sh->entries = entries + s * per_entries;
+		sh->buckets = buckets + s * per_buckets;
+		sh->capacity = per_entries;
+		sh->nbuckets = per_buckets;
+		sh->count = 0;
+		sh->head = NONE;
+		sh->tail = NONE;
+		sh->hits = 0;
+		sh->misses = 0;
+		sh->evictions = 0;
+
+		for (uint32_t b = 0; b < per_buckets; b++)
+		{
+			sh->buckets[b] = NONE;
+		}
+	}
+
+	cache->lock = lock;
+	cache->unlock = unlock;
+	cache->lock_arg = lock_arg;
+
+	return 0;
+}
+
+// lru_unlink takes entry e out of the LRU list of its shard
+static void lru_unlink(present_bs_keycache_shard_t *sh, uint32_t e)
+{
+	present_bs_keycache_entry_t *en = &sh->entries[e];
+
+	if (en->prev != NONE)
+	{
+		sh->entries[en->prev].next = en->next;
+	}
+	else
+	{
+		sh->head = en->next;
+	}
+
+	if (en->next != NONE)
+	{
+		sh->entries[en->next].prev = en->prev;
+	}
+	else
+	{
+		sh->tail = en->prev;
+	}
+}
+
+// lru_push puts entry e at the front of the LRU list, as the most recently used one
+static void lru_push(present_bs_keycache_shard_t *sh, uint32_t e)
+{
+	present_bs_keycache_entry_t *en = &sh->entries[e];
+
+	en->prev = NONE;
+	en->next = sh->head;
+
+	if (sh->head != NONE)
+	{
+		sh->entries[sh->head].prev = e;
+	}
+	else
+	{
+		sh->tail = e;
+	}
+
+	sh->head = e;
+}
+
+static uint32_t find(const present_bs_keycache_shard_t *sh, uint64_t id, uint64_t h)
+{
+	uint32_t e = sh->buckets[(h >> 32) % sh->nbuckets];
+
+	while (e != NONE && sh->entries[e].id != id)
+	{
+		e = sh->entries[e].chain;
+	}
+
+	return e;
+}
+
+/*
+ * present_bs_keycache_lookup copies the schedule of key id into ks and marks it as
+ * recently used. The copy is made while the shard is locked, so the entry can be
+ * evicted right after without affecting the caller. Returns 0 on a hit and -1 on
+ * a miss.
+ */
+int present_bs_keycache_lookup(present_bs_keycache_t *cache, uint64_t id, present_bs_key_t *ks)
+{
+	uint64_t h = mix(id);
+	uint32_t s = (uint32_t)(h % PRESENT_BS_KEYCACHE_SHARDS);
+	present_bs_keycache_shard_t *sh = &cache->shards[s];
+	int ret = -1;
+
+	lock_shard(cache, s);
+
+	uint32_t e = find(sh, id, h);
+
+	if (e != NONE)
+	{
+		*ks = sh->entries[e].ks;
+		lru_unlink(sh, e);
+		lru_push(sh, e);
+		sh->hits++;
+		ret = 0;
+	}
+	else
+	{
+		sh->misses++;
+	}
+
+	unlock_shard(cache, s);
+
+	return ret;
+}
+
+/*
+ * insert_expanded stores an expanded schedule under id. If the shard is full, its
+ * least recently used entry is evicted and reused. The shard is only locked for
+ * the copy and the list updates.
+ */
+static void insert_expanded(present_bs_keycache_t *cache, uint64_t id, const present_bs_key_t *ks)
+{
+	uint64_t h = mix(id);
+	uint32_t s = (uint32_t)(h % PRESENT_BS_KEYCACHE_SHARDS);
+	present_bs_keycache_shard_t *sh = &cache->shards[s];
+	uint8_t fresh = 1;
+	uint32_t e;
+
+	lock_shard(cache, s);
+
+	e = find(sh, id, h);
+
+	if (e != NONE)
+	{
+		lru_unlink(sh, e);
+		fresh = 0;
+	}
+	else if (sh->count < sh->capacity)
+	{
+		e = sh->count++;
+	}
+	else
+	{
+		// evict the tail, which also has to be taken out of its hash chain
+		e = sh->tail;
+		lru_unlink(sh, e);
+
+		uint32_t *link = &sh->buckets[(mix(sh->entries[e].id) >> 32) % sh->nbuckets];
+		while (*link != e)
+		{
+			link = &sh->entries[*link].chain;
+		}
+		*link = sh->entries[e].chain;
+
+		sh->evictions++;
+	}
+
+	if (fresh)
+	{
+		uint32_t *bucket = &sh->buckets[(h >> 32) % sh->nbuckets];
+
+		sh->entries[e].id = id;
+		sh->entries[e].chain = *bucket;
+		*bucket = e;
+	}
+
+	sh->entries[e].ks = *ks;
+	lru_push(sh, e);
+
+	unlock_shard(cache, s);
+}
+
+// present_bs_keycache_insert expands key, outside of any lock, and caches it under id
+void present_bs_keycache_insert(present_bs_keycache_t *cache, uint64_t id, const uint8_t key[CRYPTO_KEY_SIZE])
+{
+	present_bs_key_t ks;
+
+	present_bs_expand_key(&ks, key);
+	insert_expanded(cache, id, &ks);
+}
+
+/*
+ * present_bs_keycache_get returns the schedule of id in ks, and expands and caches
+ * key if it was not cached. Returns 0 on a hit and -1 on a miss.
+ */
+int present_bs_keycache_get(present_bs_keycache_t *cache, uint64_t id, const uint8_t key[CRYPTO_KEY_SIZE],
+	present_bs_key_t *ks)
+{
+	if (present_bs_keycache_lookup(cache, id, ks) == 0)
+	{
+		return 0;
+	}
+
+	present_bs_expand_key(ks, key);
+	insert_expanded(cache, id, ks);
+
+	return -1;
+}
+
+// present_bs_keycache_stats sums the counters of all shards
+void present_bs_keycache_stats(present_bs_keycache_t *cache, present_bs_keycache_stats_t *stats)
+{
+	stats->hits = 0;
+	stats->misses = 0;
+	stats->evictions = 0;
+	stats->count = 0;
+
+	for (uint32_t s = 0; s < PRESENT_BS_KEYCACHE_SHARDS; s++)
+	{
+		lock_shard(cache, s);
+		stats->hits += cache->shards[s].hits;
+		stats->misses += cache->shards[s].misses;
+		stats->evictions += cache->shards[s].evictions;
+		stats->count += cache->shards[s].count;
+		unlock_shard(cache, s);
+	}
+}
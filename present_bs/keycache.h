@@ -0,0 +1,65 @@
+#ifndef PRESENT_BS_KEYCACHE_H
+#define PRESENT_BS_KEYCACHE_H
+
+#include "present_bs.h"
+
+// Independent shards, each with its own lock, LRU list and hash table
+#ifndef PRESENT_BS_KEYCACHE_SHARDS
+#define PRESENT_BS_KEYCACHE_SHARDS 16
+#endif
+
+typedef struct
+{
+	uint64_t id;
+	uint32_t prev;
+	uint32_t next;
+	uint32_t chain;
+	present_bs_key_t ks;
+} present_bs_keycache_entry_t;
+
+typedef struct
+{
+	present_bs_keycache_entry_t *entries;
+	uint32_t *buckets;
+	uint32_t capacity;
+	uint32_t nbuckets;
+	uint32_t count;
+	uint32_t head;
+	uint32_t tail;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+} present_bs_keycache_shard_t;
+
+typedef struct
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint32_t count;
+} present_bs_keycache_stats_t;
+
+/*
+ * LRU cache from key ID to expanded key schedule. The memory footprint is fixed by
+ * the entry and bucket arrays handed to present_bs_keycache_init. The optional
+ * lock and unlock hooks are called with the shard index around every access, e.g.
+ * with one hardware spinlock or mutex per shard, so threads working on different
+ * shards never wait for each other.
+ */
+typedef struct
+{
+	present_bs_keycache_shard_t shards[PRESENT_BS_KEYCACHE_SHARDS];
+	void (*lock)(void *arg, uint32_t shard);
+	void (*unlock)(void *arg, uint32_t shard);
+	void *lock_arg;
+} present_bs_keycache_t;
+
+int present_bs_keycache_init(present_bs_keycache_t *cache, present_bs_keycache_entry_t *entries, uint32_t capacity,
+	uint32_t *buckets, uint32_t nbuckets, void (*lock)(void *, uint32_t), void (*unlock)(void *, uint32_t), void *lock_arg);
+int present_bs_keycache_lookup(present_bs_keycache_t *cache, uint64_t id, present_bs_key_t *ks);
+void present_bs_keycache_insert(present_bs_keycache_t *cache, uint64_t id, const uint8_t key[CRYPTO_KEY_SIZE]);
+int present_bs_keycache_get(present_bs_keycache_t *cache, uint64_t id, const uint8_t key[CRYPTO_KEY_SIZE],
+	present_bs_key_t *ks);
+void present_bs_keycache_stats(present_bs_keycache_t *cache, present_bs_keycache_stats_t *stats);
+
+#endif
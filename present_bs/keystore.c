@@ -0,0 +1,178 @@
+#include <string.h>
+
+#include "keystore.h"
+#include "util.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// keys_offset returns where the schedules start, right after the aligned ID table
+static uint64_t keys_offset(uint64_t count)
+{
+	uint64_t off = PRESENT_BS_KEYSTORE_HEADER_SIZE + count * sizeof(uint64_t);
+	return (off + PRESENT_BS_KEYSTORE_ALIGN - 1) & ~(uint64_t)(PRESENT_BS_KEYSTORE_ALIGN - 1);
+}
+
+// present_bs_keystore_size returns the number of bytes needed to store count schedules
+size_t present_bs_keystore_size(uint64_t count)
+{
+	return (size_t)(keys_offset(count) + count * sizeof(present_bs_key_t));
+}
+
+/**
+ * Write a key store
+ * @param out Output: the store, aligned to PRESENT_BS_KEYSTORE_ALIGN
+ * @param size Size of out, at least present_bs_keystore_size(count)
+ * @param ids count key IDs, strictly ascending
+ * @param keys count cipher keys of CRYPTO_KEY_SIZE bytes, in the order of ids
+ * @param count Number of keys
+ * @return 0 on success, -1 if out is too small or ids are not ascending
+ *
+ * This is the only place the key schedule runs, every later start only maps the
+ * result.
+ */
+int present_bs_keystore_build(uint8_t *out, size_t size, const uint64_t *ids, const uint8_t *keys, uint64_t count)
+{
+	if (size < present_bs_keystore_size(count))
+	{
+		return -1;
+	}
+
+	for (uint64_t i = 1; i < count; i++)
+	{
+		if (ids[i - 1] >= ids[i])
+		{
+			return -1;
+		}
+	}
+
+	memset(out, 0, (size_t)keys_offset(count));
+	memcpy(out, PRESENT_BS_KEYSTORE_MAGIC, 8);
+	put32(out + 8, PRESENT_BS_KEYSTORE_VERSION);
+	put32(out + 12, sizeof(present_bs_key_t));
+	put64(out + 16, count);
+	put64(out + 24, keys_offset(count));
+
+	present_bs_key_t *ks = (present_bs_key_t *)(out + keys_offset(count));
+
+	for (uint64_t i = 0; i < count; i++)
+	{
+		put64(out + PRESENT_BS_KEYSTORE_HEADER_SIZE + i * sizeof(uint64_t), ids[i]);
+		present_bs_expand_key(&ks[i], keys + i * CRYPTO_KEY_SIZE);
+	}
+
+	return 0;
+}
+
+/*
+ * present_bs_keystore_open sets up a view of a store in memory, no copy is made and
+ * nothing is expanded. Only the header and the size are checked, the ID order is
+ * trusted. Returns -1 if the data is not a store of this build.
+ */
+int present_bs_keystore_open(present_bs_keystore_t *s, const void *data, size_t size)
+{
+	const uint8_t *b = data;
+
+	if (size < PRESENT_BS_KEYSTORE_HEADER_SIZE || memcmp(b, PRESENT_BS_KEYSTORE_MAGIC, 8)
+		|| get32(b + 8) != PRESENT_BS_KEYSTORE_VERSION || get32(b + 12) != sizeof(present_bs_key_t))
+	{
+		return -1;
+	}
+
+	uint64_t count = get64(b + 16);
+
+	if (count > (size - PRESENT_BS_KEYSTORE_HEADER_SIZE) / sizeof(present_bs_key_t)
+		|| get64(b + 24) != keys_offset(count) || size < present_bs_keystore_size(count))
+	{
+		return -1;
+	}
+
+	s->ids = b + PRESENT_BS_KEYSTORE_HEADER_SIZE;
+	s->keys = (const present_bs_key_t *)(b + keys_offset(count));
+	s->count = count;
+	s->size = size;
+	s->mapped = 0;
+
+	return 0;
+}
+
+// present_bs_keystore_find returns the schedule of a key ID by binary search, or 0
+const present_bs_key_t *present_bs_keystore_find(const present_bs_keystore_t *s, uint64_t id)
+{
+	uint64_t lo = 0, hi = s->count;
+
+	while (lo < hi)
+	{
+		uint64_t mid = lo + (hi - lo) / 2;
+		uint64_t v = get64(s->ids + mid * sizeof(uint64_t));
+
+		if (v == id)
+		{
+			return &s->keys[mid];
+		}
+		if (v < id)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return 0;
+}
+
+#if defined(__linux__)
+/*
+ * present_bs_keystore_map maps a store file read-only and opens it. Pages are only
+ * read on first use, so startup does not depend on the number of keys.
+ */
+int present_bs_keystore_map(present_bs_keystore_t *s, const char *path)
+{
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	if (fstat(fd, &st) || st.st_size == 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	void *mem = mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (mem == MAP_FAILED)
+	{
+		return -1;
+	}
+
+	if (present_bs_keystore_open(s, mem, (size_t)st.st_size))
+	{
+		munmap(mem, (size_t)st.st_size);
+		return -1;
+	}
+
+	s->mapped = 1;
+
+	return 0;
+}
+
+void present_bs_keystore_unmap(present_bs_keystore_t *s)
+{
+	if (s->mapped)
+	{
+		munmap((void *)(s->ids - PRESENT_BS_KEYSTORE_HEADER_SIZE), s->size);
+		s->mapped = 0;
+	}
+}
+#endif
@@ -0,0 +1,46 @@
+#ifndef PRESENT_BS_KEYSTORE_H
+#define PRESENT_BS_KEYSTORE_H
+
+#include "present_bs.h"
+
+#define PRESENT_BS_KEYSTORE_MAGIC "PRSTKEYS"
+#define PRESENT_BS_KEYSTORE_VERSION 1
+#define PRESENT_BS_KEYSTORE_ALIGN 64
+#define PRESENT_BS_KEYSTORE_HEADER_SIZE 64
+
+/*
+ * Persisted store of expanded key schedules, all fields little endian:
+ *
+ *   0   magic "PRSTKEYS"
+ *   8   u32 version
+ *   12  u32 schedule size, sizeof(present_bs_key_t)
+ *   16  u64 key count
+ *   24  u64 offset of the schedules
+ *   32  zero up to PRESENT_BS_KEYSTORE_HEADER_SIZE
+ *   64  key IDs as u64, strictly ascending
+ *       schedules as present_bs_key_t in ID order, starting at the next
+ *       PRESENT_BS_KEYSTORE_ALIGN boundary
+ *
+ * A schedule is a byte array, so the entries can be passed to the cipher straight
+ * from the mapped file or from flash, and opening a store only checks the header.
+ */
+typedef struct
+{
+	const uint8_t *ids;
+	const present_bs_key_t *keys;
+	uint64_t count;
+	size_t size;
+	uint8_t mapped;
+} present_bs_keystore_t;
+
+size_t present_bs_keystore_size(uint64_t count);
+int present_bs_keystore_build(uint8_t *out, size_t size, const uint64_t *ids, const uint8_t *keys, uint64_t count);
+int present_bs_keystore_open(present_bs_keystore_t *s, const void *data, size_t size);
+const present_bs_key_t *present_bs_keystore_find(const present_bs_keystore_t *s, uint64_t id);
+
+#if defined(__linux__)
+int present_bs_keystore_map(present_bs_keystore_t *s, const char *path);
+void present_bs_keystore_unmap(present_bs_keystore_t *s);
+#endif
+
+#endif
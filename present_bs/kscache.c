@@ -0,0 +1,228 @@
+#include "kscache.h"
+
+/*
+ * present_bs_kscache_init hands budget bytes of mem to count windows. Every window
+ * gets a whole number of batches, so keystream is always produced in full bitsliced
+ * batches. Returns -1 if the budget does not give each window at least one batch.
+ */
+int present_bs_kscache_init(present_bs_kscache_t *cache, present_bs_kscache_window_t *windows, uint32_t count,
+	uint8_t *mem, size_t budget, uint32_t watermark)
+{
+	size_t per = count ? budget / count / PRESENT_BS_BATCH_SIZE * PRESENT_BS_BATCH_SIZE : 0;
+
+	if (per == 0 || per > 0x7FFFFFFFu)
+	{
+		return -1;
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		windows[i].ring = mem + i * per;
+		windows[i].size = (uint32_t)per;
+		windows[i].in_use = 0;
+		windows[i].filling = 0;
+	}
+
+	cache->windows = windows;
+	cache->count = count;
+	cache->watermark = watermark;
+
+	return 0;
+}
+
+// ring_used returns the number of ready bytes between the indices head and tail
+static uint32_t ring_used(const present_bs_kscache_window_t *win, uint32_t head, uint32_t tail)
+{
+	return tail >= head ? tail - head : tail + 2 * win->size - head;
+}
+
+static uint32_t ring_pos(const present_bs_kscache_window_t *win, uint32_t idx)
+{
+	return idx >= win->size ? idx - win->size : idx;
+}
+
+static uint32_t ring_advance(const present_bs_kscache_window_t *win, uint32_t idx, uint32_t n)
+{
+	idx += n;
+	return idx >= 2 * win->size ? idx - 2 * win->size : idx;
+}
+
+/*
+ * The filling flag makes the producer side exclusive: refill only tries to take it
+ * and skips a busy window, the request path waits for it, which takes at most one
+ * fill of the window.
+ */
+static int fill_trylock(present_bs_kscache_window_t *win)
+{
+	return !__atomic_exchange_n(&win->filling, 1, __ATOMIC_ACQUIRE);
+}
+
+static void fill_lock(present_bs_kscache_window_t *win)
+{
+	while (!fill_trylock(win))
+	{
+	}
+}
+
+static void fill_unlock(present_bs_kscache_window_t *win)
+{
+	__atomic_store_n(&win->filling, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * fill_window generates batches into the free part of the ring until it is full,
+ * or, if want is not 0, until at least want bytes are ready. The free part always
+ * starts on a batch boundary, as only whole batches are ever added. Every batch is
+ * published with a release store of tail, so the consumer never sees the index
+ * before the keystream. Called with the filling flag held.
+ */
+static void fill_window(present_bs_kscache_window_t *win, uint32_t want)
+{
+	uint32_t head = __atomic_load_n(&win->head, __ATOMIC_ACQUIRE);
+	uint32_t tail = win->tail;
+
+	while (win->size - ring_used(win, head, tail) >= PRESENT_BS_BATCH_SIZE
+		&& (want == 0 || ring_used(win, head, tail) < want))
+	{
+		present_bs_ctr_keystream(win->ks, win->fill_ctr, win->ring + ring_pos(win, tail));
+		win->fill_ctr += BITSLICE_WIDTH;
+		tail = ring_advance(win, tail, PRESENT_BS_BATCH_SIZE);
+		__atomic_store_n(&win->tail, tail, __ATOMIC_RELEASE);
+	}
+}
+
+/*
+ * present_bs_kscache_open claims a free window for the CTR stream starting at the
+ * counter block nonce and fills it. Returns the window handle, or -1 if all windows
+ * are in use.
+ */
+int present_bs_kscache_open(present_bs_kscache_t *cache, const present_bs_key_t *ks, uint64_t nonce)
+{
+	for (uint32_t i = 0; i < cache->count; i++)
+	{
+		present_bs_kscache_window_t *win = &cache->windows[i];
+
+		if (!win->in_use)
+		{
+			fill_lock(win);
+			win->ks = ks;
+			win->nonce = nonce;
+			win->offset = 0;
+			win->fill_ctr = nonce;
+			win->head = 0;
+			win->tail = 0;
+			fill_window(win, 0);
+			__atomic_store_n(&win->in_use, 1, __ATOMIC_RELEASE);
+			fill_unlock(win);
+
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+// present_bs_kscache_close releases a window and wipes the keystream it still held
+void present_bs_kscache_close(present_bs_kscache_t *cache, int w)
+{
+	present_bs_kscache_window_t *win = &cache->windows[w];
+
+	fill_lock(win);
+
+	for (uint32_t i = 0; i < win->size; i++)
+	{
+		win->ring[i] = 0;
+	}
+
+	__atomic_store_n(&win->in_use, 0, __ATOMIC_RELEASE);
+	fill_unlock(win);
+}
+
+/*
+ * present_bs_kscache_refill tops up every open window that has dropped below the
+ * watermark. It is meant to run off the request path, from an idle loop or on the
+ * second core, while the request path only consumes ready keystream. Windows that
+ * the request path is filling itself at that moment are skipped.
+ */
+void present_bs_kscache_refill(present_bs_kscache_t *cache)
+{
+	for (uint32_t i = 0; i < cache->count; i++)
+	{
+		present_bs_kscache_window_t *win = &cache->windows[i];
+
+		if (!__atomic_load_n(&win->in_use, __ATOMIC_ACQUIRE) || !fill_trylock(win))
+		{
+			continue;
+		}
+
+		uint32_t head = __atomic_load_n(&win->head, __ATOMIC_ACQUIRE);
+
+		if (win->in_use && ring_used(win, head, win->tail) < cache->watermark)
+		{
+			fill_window(win, 0);
+		}
+
+		fill_unlock(win);
+	}
+}
+
+/*
+ * present_bs_kscache_xor encrypts or decrypts one message by XORing it with ready
+ * keystream of window w. Only if the window runs dry is keystream generated on the
+ * spot. Every message starts on a block boundary, so the message is the same as
+ * present_bs_ctr_xor at counter nonce + offset / CRYPTO_IN_SIZE, where offset is the
+ * byte offset returned here.
+ *
+ * Used keystream is wiped before head is published with a release store, after
+ * which the producer may overwrite it.
+ */
+uint64_t present_bs_kscache_xor(present_bs_kscache_t *cache, int w, const uint8_t *in, uint8_t *out, size_t len)
+{
+	present_bs_kscache_window_t *win = &cache->windows[w];
+	uint64_t start = win->offset;
+	uint32_t skip = (uint32_t)((CRYPTO_IN_SIZE - len % CRYPTO_IN_SIZE) % CRYPTO_IN_SIZE);
+	uint32_t head = win->head;
+
+	while (len)
+	{
+		uint32_t avail = ring_used(win, head, __atomic_load_n(&win->tail, __ATOMIC_ACQUIRE));
+
+		if (avail == 0)
+		{
+			fill_lock(win);
+			fill_window(win, len < win->size ? (uint32_t)len : win->size);
+			fill_unlock(win);
+			continue;
+		}
+
+		uint32_t pos = ring_pos(win, head);
+		size_t n = win->size - pos;
+		n = avail < n ? avail : n;
+		n = len < n ? len : n;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			out[i] = in[i] ^ win->ring[pos + i];
+			win->ring[pos + i] = 0;
+		}
+
+		head = ring_advance(win, head, (uint32_t)n);
+		__atomic_store_n(&win->head, head, __ATOMIC_RELEASE);
+		win->offset += n;
+		in += n;
+		out += n;
+		len -= n;
+	}
+
+	// drop the rest of a partial last block, the keystream is generated in whole blocks
+	for (uint32_t i = 0; i < skip; i++)
+	{
+		win->ring[ring_pos(win, head)] = 0;
+		head = ring_advance(win, head, 1);
+	}
+
+	__atomic_store_n(&win->head, head, __ATOMIC_RELEASE);
+	win->offset += skip;
+
+	return start;
+}
@@ -0,0 +1,50 @@
+#ifndef PRESENT_BS_KSCACHE_H
+#define PRESENT_BS_KSCACHE_H
+
+#include "present_bs.h"
+
+/*
+ * One window of precomputed CTR keystream for a (key, nonce) pair. The ring is a
+ * single producer, single consumer queue: head is advanced only by the consumer
+ * (present_bs_kscache_xor) and tail only by whoever holds the filling flag, both
+ * run from 0 to 2 * size - 1 so that a full ring can be told from an empty one.
+ * offset counts the bytes handed out since the window was opened.
+ */
+typedef struct
+{
+	const present_bs_key_t *ks;
+	uint64_t nonce;
+	uint64_t offset;
+	uint64_t fill_ctr;
+	uint8_t *ring;
+	uint32_t size;
+	uint32_t head;
+	uint32_t tail;
+	uint8_t in_use;
+	uint8_t filling;
+} present_bs_kscache_window_t;
+
+/*
+ * Keystream cache. The memory budget is split evenly between the windows, and a
+ * window is topped up by present_bs_kscache_refill once it holds fewer than
+ * watermark ready bytes.
+ *
+ * Refill may run on another core or thread than the request path, e.g. in a loop
+ * started with multicore_launch_core1, or from an idle loop on the same core. The
+ * request path (open, xor, close) has to stay on one thread.
+ */
+typedef struct
+{
+	present_bs_kscache_window_t *windows;
+	uint32_t count;
+	uint32_t watermark;
+} present_bs_kscache_t;
+
+int present_bs_kscache_init(present_bs_kscache_t *cache, present_bs_kscache_window_t *windows, uint32_t count,
+	uint8_t *mem, size_t budget, uint32_t watermark);
+int present_bs_kscache_open(present_bs_kscache_t *cache, const present_bs_key_t *ks, uint64_t nonce);
+void present_bs_kscache_close(present_bs_kscache_t *cache, int w);
+void present_bs_kscache_refill(present_bs_kscache_t *cache);
+uint64_t present_bs_kscache_xor(present_bs_kscache_t *cache, int w, const uint8_t *in, uint8_t *out, size_t len);
+
+#endif
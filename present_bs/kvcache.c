@@ -0,0 +1,346 @@
+#include <string.h>
+
+#include "kvcache.h"
+#include "packet.h"
+#include "util.h"
+
+#define NONE 0xFFFFFFFFu
+
+static void lock(present_bs_kvcache_t *cache)
+{
+	if (cache->lock)
+	{
+		cache->lock(cache->lock_arg);
+	}
+}
+
+static void unlock(present_bs_kvcache_t *cache)
+{
+	if (cache->unlock)
+	{
+		cache->unlock(cache->lock_arg);
+	}
+}
+
+/*
+ * present_bs_kvcache_init sets up an empty cache. slot_size has to be a non-zero
+ * multiple of CRYPTO_IN_SIZE and slots must hold capacity * slot_size bytes. instance
+ * selects the counter range, it must be unique per key, see kvcache.h. Returns -1 if
+ * the sizes do not fit.
+ */
+int present_bs_kvcache_init(present_bs_kvcache_t *cache, const present_bs_key_t *ks, present_bs_kvcache_entry_t *entries,
+	uint8_t *slots, uint32_t capacity, uint32_t slot_size, uint32_t *buckets, uint32_t nbuckets, uint16_t instance,
+	void (*lock)(void *), void (*unlock)(void *), void *lock_arg)
+{
+	if (capacity == 0 || capacity == NONE || nbuckets == 0 || slot_size == 0 || slot_size % CRYPTO_IN_SIZE)
+	{
+		return -1;
+	}
+
+	cache->ks = ks;
+	cache->entries = entries;
+	cache->slots = slots;
+	cache->buckets = buckets;
+	cache->capacity = capacity;
+	cache->slot_size = slot_size;
+	cache->nbuckets = nbuckets;
+	cache->count = 0;
+	cache->top = 0;
+	cache->free = NONE;
+	cache->head = NONE;
+	cache->tail = NONE;
+	cache->next_nonce = (uint64_t)instance << PRESENT_BS_KVCACHE_INSTANCE_SHIFT;
+	cache->nonce_end = cache->next_nonce + ((uint64_t)1 << PRESENT_BS_KVCACHE_INSTANCE_SHIFT);
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
+	cache->lock = lock;
+	cache->unlock = unlock;
+	cache->lock_arg = lock_arg;
+
+	for (uint32_t b = 0; b < nbuckets; b++)
+	{
+		buckets[b] = NONE;
+	}
+
+	return 0;
+}
+
+static void lru_unlink(present_bs_kvcache_t *cache, uint32_t e)
+{
+	present_bs_kvcache_entry_t *en = &cache->entries[e];
+
+	if (en->prev != NONE)
+	{
+		cache->entries[en->prev].next = en->next;
+	}
+	else
+	{
+		cache->head = en->next;
+	}
+
+	if (en->next != NONE)
+	{
+		cache->entries[en->next].prev = en->prev;
+	}
+	else
+	{
+		cache->tail = en->prev;
+	}
+}
+
+static void lru_push(present_bs_kvcache_t *cache, uint32_t e)
+{
+	present_bs_kvcache_entry_t *en = &cache->entries[e];
+
+	en->prev = NONE;
+	en->next = cache->head;
+
+	if (cache->head != NONE)
+	{
+		cache->entries[cache->head].prev = e;
+	}
+	else
+	{
+		cache->tail = e;
+	}
+
+	cache->head = e;
+}
+
+static uint32_t *bucket(present_bs_kvcache_t *cache, uint64_t key)
+{
+	return &cache->buckets[(mix(key) >> 32) % cache->nbuckets];
+}
+
+static uint32_t find(present_bs_kvcache_t *cache, uint64_t key)
+{
+	uint32_t e = *bucket(cache, key);
+
+	while (e != NONE && cache->entries[e].key != key)
+	{
+		e = cache->entries[e].chain;
+	}
+
+	return e;
+}
+
+// drop takes entry e out of its hash chain and the LRU list and puts it on the free list
+static void drop(present_bs_kvcache_t *cache, uint32_t e)
+{
+	uint32_t *link = bucket(cache, cache->entries[e].key);
+
+	while (*link != e)
+	{
+		link = &cache->entries[*link].chain;
+	}
+	*link = cache->entries[e].chain;
+
+	lru_unlink(cache, e);
+	cache->entries[e].len = PRESENT_BS_KVCACHE_MISS;
+	cache->entries[e].chain = cache->free;
+	cache->free = e;
+	cache->count--;
+}
+
+/*
+ * present_bs_kvcache_put stores value under key, replacing an older value. The value
+ * is encrypted in place in its slot. When the cache is full the least recently used
+ * entry is evicted. Returns -1 if len exceeds the slot size or the counters of this
+ * instance are used up; the old value, if any, is kept then.
+ */
+int present_bs_kvcache_put(present_bs_kvcache_t *cache, uint64_t key, const uint8_t *value, uint32_t len)
+{
+	if (len > cache->slot_size)
+	{
+		return -1;
+	}
+
+	lock(cache);
+
+	// nonce_end is 0 for the last instance, where the range ends at 2^64
+	if (cache->nonce_end - cache->next_nonce < cache->slot_size / CRYPTO_IN_SIZE)
+	{
+		unlock(cache);
+		return -1;
+	}
+
+	uint32_t e = find(cache, key);
+
+	if (e != NONE)
+	{
+		drop(cache, e);
+	}
+	else if (cache->count == cache->capacity)
+	{
+		drop(cache, cache->tail);
+		cache->evictions++;
+	}
+
+	if (cache->free != NONE)
+	{
+		e = cache->free;
+		cache->free = cache->entries[e].chain;
+	}
+	else
+	{
+		e = cache->top++;
+	}
+
+	present_bs_kvcache_entry_t *en = &cache->entries[e];
+	uint32_t *b = bucket(cache, key);
+	uint8_t *slot = cache->slots + (size_t)e * cache->slot_size;
+
+	en->key = key;
+	en->nonce = cache->next_nonce;
+	en->len = len;
+	en->chain = *b;
+	*b = e;
+	lru_push(cache, e);
+	cache->count++;
+	cache->next_nonce += cache->slot_size / CRYPTO_IN_SIZE;
+
+	memcpy(slot, value, len);
+	present_bs_packet_t pkt = { .nonce = en->nonce, .buf = slot, .len = len };
+	present_bs_packet_ctr(cache->ks, &pkt, 1);
+
+	unlock(cache);
+
+	return 0;
+}
+
+// present_bs_kvcache_remove deletes key, returns -1 if it was not cached
+int present_bs_kvcache_remove(present_bs_kvcache_t *cache, uint64_t key)
+{
+	lock(cache);
+
+	uint32_t e = find(cache, key);
+
+	if (e != NONE)
+	{
+		drop(cache, e);
+	}
+
+	unlock(cache);
+
+	return e != NONE ? 0 : -1;
+}
+
+/*
+ * gather copies the ciphertext of entry e into out and records the packet that
+ * decrypts it there. Called with the cache locked.
+ */
+static void gather(present_bs_kvcache_t *cache, uint32_t e, uint8_t *out, present_bs_packet_t *pkt)
+{
+	const present_bs_kvcache_entry_t *en = &cache->entries[e];
+
+	memcpy(out, cache->slots + (size_t)e * cache->slot_size, en->len);
+	pkt->nonce = en->nonce;
+	pkt->buf = out;
+	pkt->len = en->len;
+}
+
+/**
+ * Look up many keys and decrypt their values in shared batches
+ * @param cache Cache
+ * @param keys n keys
+ * @param n Number of keys
+ * @param out n reply buffers of at least slot_size bytes, receive the plaintext values
+ * @param lens Output: value lengths, PRESENT_BS_KVCACHE_MISS for missing keys
+ * @return Number of hits
+ *
+ * The keys are handled in groups of PRESENT_BS_KVCACHE_GET_BATCH. The lock is only
+ * held while a group is looked up and its ciphertext gathered, decryption runs
+ * unlocked on the reply buffers.
+ */
+size_t present_bs_kvcache_get(present_bs_kvcache_t *cache, const uint64_t *keys, size_t n, uint8_t *const *out,
+	uint32_t *lens)
+{
+	present_bs_packet_t pkts[PRESENT_BS_KVCACHE_GET_BATCH];
+	size_t hits = 0;
+
+	for (size_t first = 0; first < n; first += PRESENT_BS_KVCACHE_GET_BATCH)
+	{
+		size_t m = n - first < PRESENT_BS_KVCACHE_GET_BATCH ? n - first : PRESENT_BS_KVCACHE_GET_BATCH;
+		size_t count = 0;
+
+		lock(cache);
+
+		for (size_t i = first; i < first + m; i++)
+		{
+			uint32_t e = find(cache, keys[i]);
+
+			if (e == NONE)
+			{
+				lens[i] = PRESENT_BS_KVCACHE_MISS;
+				cache->misses++;
+				continue;
+			}
+
+			gather(cache, e, out[i], &pkts[count++]);
+			lens[i] = cache->entries[e].len;
+			lru_unlink(cache, e);
+			lru_push(cache, e);
+			cache->hits++;
+		}
+
+		unlock(cache);
+
+		present_bs_packet_ctr(cache->ks, pkts, count);
+		hits += count;
+	}
+
+	return hits;
+}
+
+/**
+ * Read the cached values in slot order, e.g. to export or warm up another cache
+ * @param cache Cache
+ * @param cursor Input: slot to start at, 0 for the first call, Output: slot to continue at
+ * @param keys Output: keys of the returned values
+ * @param out n reply buffers of at least slot_size bytes, receive the plaintext values
+ * @param lens Output: value lengths
+ * @param n Maximum number of values to return
+ * @return Number of values returned, 0 once the scan is complete
+ *
+ * Scanning does not change the LRU order. Values put or removed between calls may
+ * or may not be returned.
+ */
+size_t present_bs_kvcache_scan(present_bs_kvcache_t *cache, uint32_t *cursor, uint64_t *keys, uint8_t *const *out,
+	uint32_t *lens, size_t n)
+{
+	present_bs_packet_t pkts[PRESENT_BS_KVCACHE_GET_BATCH];
+	size_t done = 0;
+
+	while (done < n)
+	{
+		size_t count = 0;
+
+		lock(cache);
+
+		while (*cursor < cache->top && done + count < n && count < PRESENT_BS_KVCACHE_GET_BATCH)
+		{
+			uint32_t e = (*cursor)++;
+
+			if (cache->entries[e].len != PRESENT_BS_KVCACHE_MISS)
+			{
+				keys[done + count] = cache->entries[e].key;
+				lens[done + count] = cache->entries[e].len;
+				gather(cache, e, out[done + count], &pkts[count]);
+				count++;
+			}
+		}
+
+		unlock(cache);
+
+		if (count == 0)
+		{
+			break;
+		}
+
+		present_bs_packet_ctr(cache->ks, pkts, count);
+		done += count;
+	}
+
+	return done;
+}
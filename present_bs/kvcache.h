@@ -0,0 +1,84 @@
+#ifndef PRESENT_BS_KVCACHE_H
+#define PRESENT_BS_KVCACHE_H
+
+#include "present_bs.h"
+
+// Values gathered per shared decryption pass of a multi-get or scan
+#ifndef PRESENT_BS_KVCACHE_GET_BATCH
+#define PRESENT_BS_KVCACHE_GET_BATCH 64
+#endif
+
+/*
+ * Counter blocks are split between cache instances: instance i owns the counters
+ * i << PRESENT_BS_KVCACHE_INSTANCE_SHIFT up to the next instance, 2^48 blocks, and
+ * every put takes slot_size / CRYPTO_IN_SIZE of them.
+ */
+#define PRESENT_BS_KVCACHE_INSTANCE_SHIFT 48
+
+// Length reported for keys that are not in the cache
+#define PRESENT_BS_KVCACHE_MISS 0xFFFFFFFFu
+
+typedef struct
+{
+	uint64_t key;
+	uint64_t nonce;
+	uint32_t len;
+	uint32_t prev;
+	uint32_t next;
+	uint32_t chain;
+} present_bs_kvcache_entry_t;
+
+/*
+ * LRU key-value cache that keeps every value CTR encrypted in a fixed size slot.
+ * Each put takes a fresh range of counter blocks, so a slot is never encrypted twice
+ * under the same counters.
+ *
+ * Counters only stay unique if no two caches ever use the same instance number
+ * under the same key. That includes a cache that is set up again after a restart:
+ * it needs a new instance number, e.g. from a persisted boot counter, or a new key.
+ * Once an instance has used up its counters, put fails until the cache is set up
+ * again with a fresh instance or key.
+ *
+ * The footprint is fixed by the arrays handed to init:
+ * capacity entries, capacity slots of slot_size bytes and nbuckets hash buckets.
+ *
+ * Gets copy the ciphertext of all requested values into the reply buffers while the
+ * cache is locked, and decrypt them afterwards with present_bs_packet_ctr, so the
+ * blocks of many small values share bitsliced batches instead of one mostly empty
+ * batch per value. The optional lock and unlock hooks guard the cache structure.
+ */
+typedef struct
+{
+	const present_bs_key_t *ks;
+	present_bs_kvcache_entry_t *entries;
+	uint8_t *slots;
+	uint32_t *buckets;
+	uint32_t capacity;
+	uint32_t slot_size;
+	uint32_t nbuckets;
+	uint32_t count;
+	uint32_t top;
+	uint32_t free;
+	uint32_t head;
+	uint32_t tail;
+	uint64_t next_nonce;
+	uint64_t nonce_end;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	void (*lock)(void *arg);
+	void (*unlock)(void *arg);
+	void *lock_arg;
+} present_bs_kvcache_t;
+
+int present_bs_kvcache_init(present_bs_kvcache_t *cache, const present_bs_key_t *ks, present_bs_kvcache_entry_t *entries,
+	uint8_t *slots, uint32_t capacity, uint32_t slot_size, uint32_t *buckets, uint32_t nbuckets, uint16_t instance,
+	void (*lock)(void *), void (*unlock)(void *), void *lock_arg);
+int present_bs_kvcache_put(present_bs_kvcache_t *cache, uint64_t key, const uint8_t *value, uint32_t len);
+int present_bs_kvcache_remove(present_bs_kvcache_t *cache, uint64_t key);
+size_t present_bs_kvcache_get(present_bs_kvcache_t *cache, const uint64_t *keys, size_t n, uint8_t *const *out,
+	uint32_t *lens);
+size_t present_bs_kvcache_scan(present_bs_kvcache_t *cache, uint32_t *cursor, uint64_t *keys, uint8_t *const *out,
+	uint32_t *lens, size_t n);
+
+#endif
@@ -0,0 +1,57 @@
+#include "packet.h"
+
+/*
+ * packet_flush encrypts the counters of the filled lanes with one bitsliced call
+ * and XORs every keystream block into the packet bytes the lane stands for.
+ */
+static void packet_flush(const present_bs_key_t *ks, uint64_t ctr[BITSLICE_WIDTH],
+	uint8_t *dst[BITSLICE_WIDTH], const uint8_t bytes[BITSLICE_WIDTH], uint32_t lanes)
+{
+	present_bs_encrypt_u64(ks, ctr, lanes);
+
+	for (uint32_t l = 0; l < lanes; l++)
+	{
+		for (uint8_t b = 0; b < bytes[l]; b++)
+		{
+			dst[l][b] ^= (uint8_t)(ctr[l] >> (b * 8));
+		}
+	}
+}
+
+/*
+ * present_bs_packet_ctr encrypts (or decrypts) many small packets at once. Instead of
+ * one batch per packet, every keystream block of every packet gets its own lane: the
+ * blocks are assigned to lanes in order, across packet boundaries, and a bitsliced
+ * call is made whenever BITSLICE_WIDTH lanes are filled. Each lane remembers where its
+ * block lives and how many bytes of it are valid, which handles the uneven lengths.
+ */
+void present_bs_packet_ctr(const present_bs_key_t *ks, const present_bs_packet_t *pkts, size_t count)
+{
+	uint64_t ctr[BITSLICE_WIDTH];
+	uint8_t *dst[BITSLICE_WIDTH];
+	uint8_t bytes[BITSLICE_WIDTH];
+	uint32_t lanes = 0;
+
+	for (size_t p = 0; p < count; p++)
+	{
+		for (size_t off = 0, j = 0; off < pkts[p].len; off += CRYPTO_IN_SIZE, j++)
+		{
+			size_t left = pkts[p].len - off;
+
+			ctr[lanes] = pkts[p].nonce + j;
+			dst[lanes] = pkts[p].buf + off;
+			bytes[lanes] = left < CRYPTO_IN_SIZE ? (uint8_t)left : CRYPTO_IN_SIZE;
+
+			if (++lanes == BITSLICE_WIDTH)
+			{
+				packet_flush(ks, ctr, dst, bytes, lanes);
+				lanes = 0;
+			}
+		}
+	}
+
+	if (lanes)
+	{
+		packet_flush(ks, ctr, dst, bytes, lanes);
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef PRESENT_BS_PACKET_H
+#define PRESENT_BS_PACKET_H
+
+#include "present_bs.h"
+
+/*
+ * One packet for present_bs_packet_ctr. Block j of the packet is XORed with
+ * E(nonce + j), the last block may be partial.
+ */
+typedef struct
+{
+	uint64_t nonce;
+	uint8_t *buf;
+	size_t len;
+} present_bs_packet_t;
+
+void present_bs_packet_ctr(const present_bs_key_t *ks, const present_bs_packet_t *pkts, size_t count);
+
+#endif
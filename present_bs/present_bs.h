@@ -0,0 +1,85 @@
+#ifndef PRESENT_BS_H
+#define PRESENT_BS_H
+
+#include <stddef.h>
+#include "crypto.h"
+
+// Number of full rounds; the cipher uses one more round key for the final whitening
+#define PRESENT_BS_ROUNDS 31
+
+// Size in bytes of one batch, i.e. BITSLICE_WIDTH blocks in normal form
+#define PRESENT_BS_BATCH_SIZE (CRYPTO_IN_SIZE * BITSLICE_WIDTH)
+
+/*
+ * Batches that large inputs keep in flight at once, running every round across all
+ * of them. Each one costs CRYPTO_IN_SIZE_BIT registers worth of state, 4 keeps the
+ * working set at 1 KB with 32 lanes.
+ */
+#ifndef PRESENT_BS_BULK_K
+#define PRESENT_BS_BULK_K 4
+#endif
+
+/*
+ * Expanded key schedule. rk[0] is the first round key and rk[PRESENT_BS_ROUNDS] the
+ * final whitening key, each in the same byte order as a normal form block.
+ */
+typedef struct
+{
+	uint8_t rk[PRESENT_BS_ROUNDS + 1][CRYPTO_IN_SIZE];
+} present_bs_key_t;
+
+/*
+ * Batch in bitsliced form: bit l of s[i] is bit i of the block in lane l. Rounds are
+ * numbered 0 ... PRESENT_BS_ROUNDS, the last one only adds the final round key, so
+ * rounds 0 ... PRESENT_BS_ROUNDS (first = 0, count = PRESENT_BS_ROUNDS + 1) form one
+ * full encryption.
+ */
+typedef struct
+{
+	bs_reg_t s[CRYPTO_IN_SIZE_BIT];
+} present_bs_state_t;
+
+// Size in bits of the key register
+#define PRESENT_BS_KEY_BITS (CRYPTO_KEY_SIZE * 8)
+
+/*
+ * One cipher key per lane in bitsliced form: bit l of k[i] is bit i of the key of
+ * lane l, in the bit order of a normal form key.
+ */
+typedef struct
+{
+	bs_reg_t k[PRESENT_BS_KEY_BITS];
+} present_bs_lanekey_t;
+
+void present_bs_expand_key(present_bs_key_t *ks, const uint8_t key[CRYPTO_KEY_SIZE]);
+void present_bs_encrypt_batch(uint8_t pt[PRESENT_BS_BATCH_SIZE], const present_bs_key_t *ks);
+void present_bs_decrypt_batch(uint8_t ct[PRESENT_BS_BATCH_SIZE], const present_bs_key_t *ks);
+void present_bs_encrypt_blocks(const present_bs_key_t *ks, uint8_t *blocks, size_t n);
+void present_bs_decrypt_blocks(const present_bs_key_t *ks, uint8_t *blocks, size_t n);
+void present_bs_reencrypt_blocks(const present_bs_key_t *old_ks, const present_bs_key_t *new_ks, uint8_t *blocks, size_t n);
+
+void present_bs_ctr_keystream(const present_bs_key_t *ks, uint64_t ctr, uint8_t stream[PRESENT_BS_BATCH_SIZE]);
+void present_bs_ctr_xor(const present_bs_key_t *ks, uint64_t ctr, const uint8_t *in, uint8_t *out, size_t len);
+void present_bs_ctr_rekey(const present_bs_key_t *old_ks, uint64_t old_ctr, const present_bs_key_t *new_ks,
+	uint64_t new_ctr, const uint8_t *in, uint8_t *out, size_t len);
+
+void present_bs_encrypt_u64(const present_bs_key_t *ks, uint64_t *v, size_t n);
+void present_bs_decrypt_u64(const present_bs_key_t *ks, uint64_t *v, size_t n);
+
+void present_bs_state_load(present_bs_state_t *st, const uint8_t pt[PRESENT_BS_BATCH_SIZE]);
+void present_bs_state_load_lanes(present_bs_state_t *st, const uint8_t *pt, uint32_t n);
+void present_bs_state_load_u64(present_bs_state_t *st, const uint64_t *v, uint32_t n);
+void present_bs_state_counter(present_bs_state_t *st, uint64_t ctr);
+void present_bs_state_store(const present_bs_state_t *st, uint8_t pt[PRESENT_BS_BATCH_SIZE]);
+void present_bs_state_store_u64(const present_bs_state_t *st, uint64_t *v, uint32_t n);
+void present_bs_state_extract(const present_bs_state_t *st, bs_reg_t mask, uint8_t *out);
+uint64_t present_bs_state_extract_bits(const present_bs_state_t *st, uint32_t lane, uint8_t first, uint8_t count);
+void present_bs_state_encrypt(present_bs_state_t *st, const present_bs_key_t *ks, uint8_t first, uint8_t count);
+void present_bs_state_decrypt(present_bs_state_t *st, const present_bs_key_t *ks, uint8_t first, uint8_t count);
+void present_bs_state_xor(present_bs_state_t *dst, const present_bs_state_t *src);
+bs_reg_t present_bs_state_compare(const present_bs_state_t *a, const present_bs_state_t *b);
+
+void present_bs_lanekey_load(present_bs_lanekey_t *key, const uint8_t *keys, uint32_t n);
+void present_bs_state_encrypt_lanekey(present_bs_state_t *st, const present_bs_lanekey_t *key);
+
+#endif
@@ -0,0 +1,338 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "region.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/userfaultfd.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define PAGE_RESIDENT 1
+#define PAGE_DIRTY 2
+
+// page_ctr returns the counter block of the first byte of page
+static uint64_t page_ctr(const present_bs_region_t *r, size_t page)
+{
+	return r->ctr + page * (r->page_size / CRYPTO_IN_SIZE);
+}
+
+static int page_protect(present_bs_region_t *r, size_t page, int protect)
+{
+	struct uffdio_writeprotect wp = {
+		.range = { .start = (uintptr_t)(r->base + page * r->page_size), .len = r->page_size },
+		.mode = protect ? UFFDIO_WRITEPROTECT_MODE_WP : 0,
+	};
+
+	return ioctl(r->uffd, UFFDIO_WRITEPROTECT, &wp);
+}
+
+static void page_wake(present_bs_region_t *r, size_t page)
+{
+	struct uffdio_range range = { .start = (uintptr_t)(r->base + page * r->page_size), .len = r->page_size };
+
+	ioctl(r->uffd, UFFDIO_WAKE, &range);
+}
+
+/*
+ * page_writeback encrypts a dirty page back into backing. The page is write protected
+ * first, so a thread writing to it meanwhile waits in the handler, and its write
+ * marks the page dirty again afterwards.
+ */
+static void page_writeback(present_bs_region_t *r, size_t page)
+{
+	size_t off = page * r->page_size;
+
+	page_protect(r, page, 1);
+	present_bs_ctr_xor(r->ks, page_ctr(r, page), r->base + off, r->backing + off, r->page_size);
+	r->flags[page] &= (uint8_t)~PAGE_DIRTY;
+	r->writebacks++;
+}
+
+// page_evict drops the oldest resident page, the next touch faults it in again
+static void page_evict(present_bs_region_t *r)
+{
+	size_t page = r->ring[r->oldest];
+
+	if (r->flags[page] & PAGE_DIRTY)
+	{
+		page_writeback(r, page);
+	}
+
+	madvise(r->base + page * r->page_size, r->page_size, MADV_DONTNEED);
+	r->flags[page] = 0;
+	r->oldest = (r->oldest + 1) % r->max_resident;
+	r->resident--;
+	r->evictions++;
+}
+
+/*
+ * page_fault decrypts a missing page into the bounce buffer and installs it. Pages
+ * touched by a read are installed write protected, pages touched by a write are
+ * dirty from the start. If the page cannot be installed, the faulting thread is
+ * woken anyway and simply faults again, and the page is not recorded as resident.
+ */
+static void page_fault(present_bs_region_t *r, size_t page, int write)
+{
+	size_t off = page * r->page_size;
+
+	if (r->flags[page] & PAGE_RESIDENT)
+	{
+		page_wake(r, page);
+		return;
+	}
+
+	if (r->resident == r->max_resident)
+	{
+		page_evict(r);
+	}
+
+	present_bs_ctr_xor(r->ks, page_ctr(r, page), r->backing + off, r->bounce, r->page_size);
+
+	struct uffdio_copy copy = {
+		.dst = (uintptr_t)(r->base + off),
+		.src = (uintptr_t)r->bounce,
+		.len = r->page_size,
+		.mode = write ? 0 : UFFDIO_COPY_MODE_WP,
+	};
+
+	int err = ioctl(r->uffd, UFFDIO_COPY, &copy) ? errno : 0;
+	memset(r->bounce, 0, r->page_size);
+
+	if (err)
+	{
+		// EEXIST: mapped meanwhile by the kernel, anything else: retry on the next fault
+		page_wake(r, page);
+		return;
+	}
+
+	r->flags[page] = PAGE_RESIDENT | (write ? PAGE_DIRTY : 0);
+	r->ring[(r->oldest + r->resident) % r->max_resident] = page;
+	r->resident++;
+	r->faults++;
+}
+
+// page_dirty handles the first write to a write protected page
+static void page_dirty(present_bs_region_t *r, size_t page)
+{
+	if (r->flags[page] & PAGE_RESIDENT)
+	{
+		r->flags[page] |= PAGE_DIRTY;
+		page_protect(r, page, 0);
+	}
+	else
+	{
+		page_wake(r, page); // evicted meanwhile, the retry faults it in again
+	}
+}
+
+static void *region_handler(void *arg)
+{
+	present_bs_region_t *r = arg;
+	struct pollfd fds[2] = { { .fd = r->uffd, .events = POLLIN }, { .fd = r->stop_fd, .events = POLLIN } };
+	struct uffd_msg msg;
+
+	for (;;)
+	{
+		if (poll(fds, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		if (fds[1].revents)
+		{
+			break;
+		}
+
+		if (read(r->uffd, &msg, sizeof(msg)) != sizeof(msg) || msg.event != UFFD_EVENT_PAGEFAULT)
+		{
+			continue;
+		}
+
+		size_t page = (size_t)(msg.arg.pagefault.address - (uintptr_t)r->base) / r->page_size;
+
+		pthread_mutex_lock(&r->lock);
+		if (msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WP)
+		{
+			page_dirty(r, page);
+		}
+		else
+		{
+			page_fault(r, page, (msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WRITE) != 0);
+		}
+		pthread_mutex_unlock(&r->lock);
+	}
+
+	return 0;
+}
+
+/**
+ * Reserve an address range backed by encrypted memory
+ * @param r Output: Region, base is the plaintext view
+ * @param ks Expanded round keys, have to stay valid until unmap
+ * @param nonce Region nonce, see PRESENT_BS_REGION_CTR
+ * @param backing Input: region ciphertext, updated in place with written pages
+ * @param size Region size, a multiple of the page size, at most 2^32 blocks
+ * @param max_resident Maximum number of pages in plaintext at once, at least 1
+ * @return 0 on success, -1 if the arguments do not fit or userfaultfd with write
+ *         protection is not available
+ */
+int present_bs_region_map(present_bs_region_t *r, const present_bs_key_t *ks, uint32_t nonce, uint8_t *backing,
+	size_t size, size_t max_resident)
+{
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	size_t pages = size / page_size;
+
+	if (size == 0 || size % page_size || page_size % PRESENT_BS_BATCH_SIZE || max_resident == 0
+		|| (uint64_t)size / CRYPTO_IN_SIZE > ((uint64_t)1 << 32))
+	{
+		return -1;
+	}
+
+	memset(r, 0, sizeof(*r));
+	r->backing = backing;
+	r->size = size;
+	r->page_size = page_size;
+	r->ks = ks;
+	r->ctr = PRESENT_BS_REGION_CTR(nonce);
+	r->max_resident = max_resident < pages ? max_resident : pages;
+	r->uffd = -1;
+	r->stop_fd = -1;
+
+	// bounce page, then the page flags and the ring of resident pages
+	r->meta_size = page_size + pages + r->max_resident * sizeof(size_t) + sizeof(size_t);
+	uint8_t *meta = mmap(0, r->meta_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	r->base = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if (meta == MAP_FAILED || r->base == MAP_FAILED)
+	{
+		goto fail;
+	}
+
+	r->bounce = meta;
+	r->flags = meta + page_size;
+	r->ring = (size_t *)(((uintptr_t)(r->flags + pages) + sizeof(size_t) - 1) & ~(uintptr_t)(sizeof(size_t) - 1));
+
+	/*
+	 * Without UFFD_USER_MODE_ONLY the handler also serves faults that the kernel takes
+	 * on base, e.g. in read or write, but that needs CAP_SYS_PTRACE or
+	 * vm.unprivileged_userfaultfd. Otherwise fall back to user faults only. The fd is
+	 * non-blocking, as poll reports POLLERR on a blocking userfaultfd, so the handler
+	 * would block in read and never see stop_fd.
+	 */
+	r->uffd = (int)syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+	if (r->uffd < 0)
+	{
+		r->uffd = (int)syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+		r->user_only = 1;
+	}
+	r->stop_fd = eventfd(0, EFD_CLOEXEC);
+	if (r->uffd < 0 || r->stop_fd < 0)
+	{
+		goto fail;
+	}
+
+	struct uffdio_api api = { .api = UFFD_API, .features = UFFD_FEATURE_PAGEFAULT_FLAG_WP };
+	struct uffdio_register reg = {
+		.range = { .start = (uintptr_t)r->base, .len = size },
+		.mode = UFFDIO_REGISTER_MODE_MISSING | UFFDIO_REGISTER_MODE_WP,
+	};
+
+	if (ioctl(r->uffd, UFFDIO_API, &api) || ioctl(r->uffd, UFFDIO_REGISTER, &reg)
+		|| !(reg.ioctls & ((uint64_t)1 << _UFFDIO_WRITEPROTECT)))
+	{
+		goto fail;
+	}
+
+	if (pthread_mutex_init(&r->lock, 0))
+	{
+		goto fail;
+	}
+	if (pthread_create(&r->thread, 0, region_handler, r))
+	{
+		pthread_mutex_destroy(&r->lock);
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	if (r->uffd >= 0)
+	{
+		close(r->uffd);
+	}
+	if (r->stop_fd >= 0)
+	{
+		close(r->stop_fd);
+	}
+	if (r->base != MAP_FAILED)
+	{
+		munmap(r->base, size);
+	}
+	if (meta != MAP_FAILED)
+	{
+		munmap(meta, r->meta_size);
+	}
+	r->base = 0;
+
+	return -1;
+}
+
+// present_bs_region_sync encrypts all dirty pages into backing, they stay resident
+void present_bs_region_sync(present_bs_region_t *r)
+{
+	pthread_mutex_lock(&r->lock);
+
+	for (size_t i = 0; i < r->resident; i++)
+	{
+		size_t page = r->ring[(r->oldest + i) % r->max_resident];
+
+		if (r->flags[page] & PAGE_DIRTY)
+		{
+			page_writeback(r, page);
+		}
+	}
+
+	pthread_mutex_unlock(&r->lock);
+}
+
+/*
+ * present_bs_region_unmap writes back dirty pages and releases the region. No other
+ * thread may touch base any more.
+ */
+void present_bs_region_unmap(present_bs_region_t *r)
+{
+	uint64_t one = 1;
+
+	if (!r->base)
+	{
+		return;
+	}
+
+	if (write(r->stop_fd, &one, sizeof(one)) == sizeof(one))
+	{
+		pthread_join(r->thread, 0);
+	}
+
+	present_bs_region_sync(r);
+	pthread_mutex_destroy(&r->lock);
+
+	close(r->uffd);
+	close(r->stop_fd);
+	munmap(r->base, r->size);
+	munmap(r->bounce, r->meta_size);
+	r->base = 0;
+}
+#endif
@@ -0,0 +1,63 @@
+#ifndef PRESENT_BS_REGION_H
+#define PRESENT_BS_REGION_H
+
+#include "present_bs.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+
+// Counter block of byte 0 of a region, every region needs its own nonce under one key
+#define PRESENT_BS_REGION_CTR(nonce) ((uint64_t)(nonce) << 32)
+
+/*
+ * Transparently encrypted memory region. base is a plaintext view of backing, which
+ * holds the region as PRESENT-CTR ciphertext starting at PRESENT_BS_REGION_CTR(nonce).
+ * Pages are decrypted by a handler thread through userfaultfd on first touch, and at
+ * most max_resident of them are in plaintext at any time: when the limit is reached
+ * the oldest page is evicted, re-encrypted into backing first if it was written.
+ *
+ * Pages are mapped write protected, so the first write to a page is seen by the
+ * handler and only dirty pages are encrypted again. Every page is a whole number of
+ * batches, so the cipher always runs at full width.
+ *
+ * If the process may not handle kernel faults through userfaultfd (no
+ * CAP_SYS_PTRACE and vm.unprivileged_userfaultfd is 0), the region falls back to
+ * user faults only and user_only is set. Then a page that is not resident cannot be
+ * accessed by the kernel: passing such a part of base to read, write or any other
+ * system call fails with EFAULT. Copy through a buffer of your own in that case.
+ */
+typedef struct
+{
+	uint8_t *base;
+	uint8_t *backing;
+	size_t size;
+	size_t page_size;
+	const present_bs_key_t *ks;
+	uint64_t ctr;
+
+	uint8_t *flags;
+	size_t *ring;
+	size_t max_resident;
+	size_t resident;
+	size_t oldest;
+	uint8_t *bounce;
+	size_t meta_size;
+
+	int uffd;
+	int stop_fd;
+	uint8_t user_only;
+	pthread_t thread;
+	pthread_mutex_t lock;
+
+	uint64_t faults;
+	uint64_t evictions;
+	uint64_t writebacks;
+} present_bs_region_t;
+
+int present_bs_region_map(present_bs_region_t *r, const present_bs_key_t *ks, uint32_t nonce, uint8_t *backing,
+	size_t size, size_t max_resident);
+void present_bs_region_sync(present_bs_region_t *r);
+void present_bs_region_unmap(present_bs_region_t *r);
+#endif
+
+#endif
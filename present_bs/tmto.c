@@ -0,0 +1,166 @@
+#include <string.h>
+
+#include "tmto.h"
+#include "util.h"
+
+#define ALL_ONES ((bs_reg_t)~(bs_reg_t)0)
+
+static uint64_t mask_bits(uint8_t bits)
+{
+	return bits >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << bits) - 1;
+}
+
+/*
+ * present_bs_tmto_init sets up the chain parameters, bits must be 1 ... 64. The low
+ * bits of base_key are cleared, as the chain points take their place.
+ */
+int present_bs_tmto_init(present_bs_tmto_t *t, const uint8_t base_key[CRYPTO_KEY_SIZE],
+	const uint8_t pt[CRYPTO_IN_SIZE], uint8_t bits, uint32_t length)
+{
+	if (bits == 0 || bits > 64)
+	{
+		return -1;
+	}
+
+	memcpy(t->base_key, base_key, CRYPTO_KEY_SIZE);
+	memcpy(t->pt, pt, CRYPTO_IN_SIZE);
+	t->bits = bits;
+	t->length = length;
+
+	for (uint8_t i = 0; i < bits; i++)
+	{
+		t->base_key[i / 8] &= (uint8_t)~(1 << (i % 8));
+	}
+
+	return 0;
+}
+
+// present_bs_tmto_key builds the key of chain point x, e.g. to verify a candidate
+void present_bs_tmto_key(const present_bs_tmto_t *t, uint64_t x, uint8_t key[CRYPTO_KEY_SIZE])
+{
+	memcpy(key, t->base_key, CRYPTO_KEY_SIZE);
+
+	for (uint8_t i = 0; i < t->bits; i++)
+	{
+		key[i / 8] |= (uint8_t)(((x >> i) & 1) << (i % 8));
+	}
+}
+
+// present_bs_tmto_reduce is the scalar reduction of column, for the lookup side
+uint64_t present_bs_tmto_reduce(const present_bs_tmto_t *t, uint64_t ct, uint32_t column)
+{
+	return (ct ^ column) & mask_bits(t->bits);
+}
+
+/*
+ * present_bs_tmto_chains walks n chains, one per lane: chains[i].start is read and
+ * chains[i].end written. The whole chain stays in the sliced domain. The points
+ * are the low entries of a sliced key register whose other entries are the constant
+ * base key, each step encrypts the constant plaintext under the per-lane keys, and
+ * the reduction copies the ciphertext entries back into the key register with the
+ * column folded in as a constant XOR. Only the start and end points are transposed.
+ */
+void present_bs_tmto_chains(const present_bs_tmto_t *t, present_bs_tmto_entry_t *chains, size_t n)
+{
+	present_bs_lanekey_t key;
+	present_bs_state_t st;
+	bs_reg_t pt[CRYPTO_IN_SIZE_BIT];
+	uint64_t v[BITSLICE_WIDTH];
+
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE_BIT; i++)
+	{
+		pt[i] = ((t->pt[i / 8] >> (i % 8)) & 1) ? ALL_ONES : 0;
+	}
+
+	while (n)
+	{
+		uint32_t lanes = n < BITSLICE_WIDTH ? (uint32_t)n : BITSLICE_WIDTH;
+
+		for (uint32_t l = 0; l < lanes; l++)
+		{
+			v[l] = chains[l].start & mask_bits(t->bits);
+		}
+		present_bs_state_load_u64(&st, v, lanes);
+
+		for (uint8_t i = 0; i < PRESENT_BS_KEY_BITS; i++)
+		{
+			if (i < t->bits)
+			{
+				key.k[i] = st.s[i];
+			}
+			else
+			{
+				key.k[i] = ((t->base_key[i / 8] >> (i % 8)) & 1) ? ALL_ONES : 0;
+			}
+		}
+
+		for (uint32_t c = 0; c < t->length; c++)
+		{
+			memcpy(st.s, pt, sizeof(pt));
+			present_bs_state_encrypt_lanekey(&st, &key);
+
+			for (uint8_t i = 0; i < t->bits; i++)
+			{
+				key.k[i] = st.s[i] ^ ((i < 32 && ((c >> i) & 1)) ? ALL_ONES : 0);
+			}
+		}
+
+		memset(st.s, 0, sizeof(st.s));
+		memcpy(st.s, key.k, t->bits * sizeof(bs_reg_t));
+		present_bs_state_store_u64(&st, v, lanes);
+
+		for (uint32_t l = 0; l < lanes; l++)
+		{
+			chains[l].end = v[l];
+		}
+
+		chains += lanes;
+		n -= lanes;
+	}
+}
+
+void present_bs_tmto_write_header(const present_bs_tmto_t *t, uint64_t count, uint8_t header[PRESENT_BS_TMTO_HEADER_SIZE])
+{
+	memset(header, 0, PRESENT_BS_TMTO_HEADER_SIZE);
+	memcpy(header, PRESENT_BS_TMTO_MAGIC, 8);
+	put32(header + 8, PRESENT_BS_TMTO_VERSION);
+	put32(header + 12, t->length);
+	put64(header + 16, count);
+	memcpy(header + 24, t->pt, CRYPTO_IN_SIZE);
+	memcpy(header + 32, t->base_key, CRYPTO_KEY_SIZE);
+	header[42] = t->bits;
+}
+
+int present_bs_tmto_read_header(present_bs_tmto_t *t, uint64_t *count, const uint8_t header[PRESENT_BS_TMTO_HEADER_SIZE])
+{
+	if (memcmp(header, PRESENT_BS_TMTO_MAGIC, 8) || get32(header + 8) != PRESENT_BS_TMTO_VERSION)
+	{
+		return -1;
+	}
+
+	*count = get64(header + 16);
+
+	return present_bs_tmto_init(t, header + 32, header + 24, header[42], get32(header + 12));
+}
+
+// present_bs_tmto_find returns the first entry with the given end point, or 0
+const present_bs_tmto_entry_t *present_bs_tmto_find(const present_bs_tmto_entry_t *table, uint64_t count, uint64_t end)
+{
+	uint64_t lo = 0, hi = count;
+
+	while (lo < hi)
+	{
+		uint64_t mid = lo + (hi - lo) / 2;
+
+		if (table[mid].end < end)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return lo < count && table[lo].end == end ? &table[lo] : 0;
+}
@@ -0,0 +1,55 @@
+#ifndef PRESENT_BS_TMTO_H
+#define PRESENT_BS_TMTO_H
+
+#include "present_bs.h"
+
+#define PRESENT_BS_TMTO_MAGIC "PRSTTMTO"
+#define PRESENT_BS_TMTO_VERSION 1
+#define PRESENT_BS_TMTO_HEADER_SIZE 64
+
+/*
+ * Rainbow chains over a reduced key space: the low bits of the key are unknown, the
+ * rest is base_key. A chain point x selects the key base_key with x in its low bits,
+ * and the next point of column c is the ciphertext of the chosen plaintext pt under
+ * that key, XORed with c and cut down to bits bits.
+ */
+typedef struct
+{
+	uint8_t base_key[CRYPTO_KEY_SIZE];
+	uint8_t pt[CRYPTO_IN_SIZE];
+	uint8_t bits;
+	uint32_t length;
+} present_bs_tmto_t;
+
+/*
+ * Table entry, tables are sorted by end. A table file is the header followed by count
+ * entries as two little endian u64, so on a little endian host a mapped file can be
+ * searched in place:
+ *
+ *   0   magic "PRSTTMTO"
+ *   8   u32 version
+ *   12  u32 chain length
+ *   16  u64 entry count
+ *   24  chosen plaintext
+ *   32  base key
+ *   42  u8 key bits
+ *   43  zero up to PRESENT_BS_TMTO_HEADER_SIZE
+ *   64  entries
+ */
+typedef struct
+{
+	uint64_t end;
+	uint64_t start;
+} present_bs_tmto_entry_t;
+
+int present_bs_tmto_init(present_bs_tmto_t *t, const uint8_t base_key[CRYPTO_KEY_SIZE],
+	const uint8_t pt[CRYPTO_IN_SIZE], uint8_t bits, uint32_t length);
+void present_bs_tmto_key(const present_bs_tmto_t *t, uint64_t x, uint8_t key[CRYPTO_KEY_SIZE]);
+uint64_t present_bs_tmto_reduce(const present_bs_tmto_t *t, uint64_t ct, uint32_t column);
+void present_bs_tmto_chains(const present_bs_tmto_t *t, present_bs_tmto_entry_t *chains, size_t n);
+
+void present_bs_tmto_write_header(const present_bs_tmto_t *t, uint64_t count, uint8_t header[PRESENT_BS_TMTO_HEADER_SIZE]);
+int present_bs_tmto_read_header(present_bs_tmto_t *t, uint64_t *count, const uint8_t header[PRESENT_BS_TMTO_HEADER_SIZE]);
+const present_bs_tmto_entry_t *present_bs_tmto_find(const present_bs_tmto_entry_t *table, uint64_t count, uint64_t end);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef PRESENT_BS_UTIL_H
+#define PRESENT_BS_UTIL_H
+
+#include <stdint.h>
+
+/*
+ * Internal helpers of the modes and tools, not part of the library interface. All
+ * multi-byte values are little endian, which is also how a normal form block reads
+ * as a 64-bit value.
+ */
+
+static inline uint32_t get32(const uint8_t *b)
+{
+	return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static inline void put32(uint8_t *b, uint32_t v)
+{
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		b[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+static inline uint64_t get64(const uint8_t *b)
+{
+	uint64_t v = 0;
+
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		v |= (uint64_t)b[i] << (i * 8);
+	}
+
+	return v;
+}
+
+static inline void put64(uint8_t *b, uint64_t v)
+{
+	for (uint8_t i = 0; i < 8; i++)
+	{
+		b[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+// mix spreads the bits of a 64-bit ID, so that sequential IDs land in different shards and buckets
+static inline uint64_t mix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ull;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+#endif
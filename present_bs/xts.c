@@ -0,0 +1,116 @@
+#include "xts.h"
+#include "util.h"
+
+// xor64 XORs a 64-bit value into a normal form block
+static void xor64(uint8_t b[CRYPTO_IN_SIZE], uint64_t v)
+{
+	for (uint8_t i = 0; i < CRYPTO_IN_SIZE; i++)
+	{
+		b[i] ^= (uint8_t)(v >> (i * 8));
+	}
+}
+
+/*
+ * gf64_double multiplies the tweak by a (= x) in GF(2^64) with the reduction
+ * polynomial x^64 + x^4 + x^3 + x + 1. The carry out of the top bit is turned
+ * into a mask so that the doubling takes the same time for every tweak.
+ */
+static uint64_t gf64_double(uint64_t t)
+{
+	uint64_t carry = 0 - (t >> 63);
+	return (t << 1) ^ (carry & 0x1B);
+}
+
+/*
+ * xts_flush runs the cipher over n pending blocks that already carry their
+ * tweak, and then removes the tweak again. A short tail batch only transposes
+ * the lanes that are in use.
+ */
+static void xts_flush(uint8_t *blocks, const uint64_t tweak[BITSLICE_WIDTH], uint32_t n,
+	const present_bs_key_t *data_ks, int decrypt)
+{
+	if (decrypt)
+	{
+		present_bs_decrypt_blocks(data_ks, blocks, n);
+	}
+	else
+	{
+		present_bs_encrypt_blocks(data_ks, blocks, n);
+	}
+
+	for (uint32_t i = 0; i < n; i++)
+	{
+		xor64(blocks + i * CRYPTO_IN_SIZE, tweak[i]);
+	}
+}
+
+/*
+ * xts_crypt is shared by encryption and decryption, which only differ in the
+ * direction of the data cipher. The tweaks are always produced with the forward
+ * cipher, BITSLICE_WIDTH sector numbers at a time, so one bitsliced call covers
+ * the tweaks of a whole group of sectors.
+ *
+ * The blocks of consecutive sectors lie next to each other in buf, so the lanes
+ * are simply filled with the next BITSLICE_WIDTH blocks, no matter which sector they
+ * belong to. Each block is whitened with its tweak in place, the tweak is kept per
+ * lane, and once all lanes are filled the run of blocks is processed as one batch.
+ */
+static void xts_crypt(const present_bs_key_t *data_ks, const present_bs_key_t *tweak_ks,
+	uint64_t sector, uint8_t *buf, size_t sector_size, size_t sectors, int decrypt)
+{
+	uint8_t tweak_batch[PRESENT_BS_BATCH_SIZE];
+	uint64_t lane_tweak[BITSLICE_WIDTH];
+	size_t blocks = sector_size / CRYPTO_IN_SIZE;
+	uint8_t *run = buf;
+	uint32_t lanes = 0;
+
+	for (size_t s = 0; s < sectors; s++)
+	{
+		uint32_t group_lane = s % BITSLICE_WIDTH;
+
+		// encrypt the sector numbers of the next group of sectors in one go
+		if (group_lane == 0)
+		{
+			for (uint32_t i = 0; i < BITSLICE_WIDTH; i++)
+			{
+				put64(tweak_batch + i * CRYPTO_IN_SIZE, sector + s + i);
+			}
+
+			present_bs_encrypt_batch(tweak_batch, tweak_ks);
+		}
+
+		uint64_t t = get64(tweak_batch + group_lane * CRYPTO_IN_SIZE);
+		uint8_t *blk = buf + s * sector_size;
+
+		for (size_t j = 0; j < blocks; j++)
+		{
+			xor64(blk + j * CRYPTO_IN_SIZE, t);
+			lane_tweak[lanes++] = t;
+			t = gf64_double(t);
+
+			if (lanes == BITSLICE_WIDTH)
+			{
+				xts_flush(run, lane_tweak, lanes, data_ks, decrypt);
+				run += PRESENT_BS_BATCH_SIZE;
+				lanes = 0;
+			}
+		}
+	}
+
+	if (lanes)
+	{
+		xts_flush(run, lane_tweak, lanes, data_ks, decrypt);
+	}
+}
+
+void present_bs_xts_encrypt(const present_bs_key_t *data_ks, const present_bs_key_t *tweak_ks,
+	uint64_t sector, uint8_t *buf, size_t sector_size, size_t sectors)
+{
+	xts_crypt(data_ks, tweak_ks, sector, buf, sector_size, sectors, 0);
+}
+
+void present_bs_xts_decrypt(const present_bs_key_t *data_ks, const present_bs_key_t *tweak_ks,
+	uint64_t sector, uint8_t *buf, size_t sector_size, size_t sectors)
+{
+	xts_crypt(data_ks, tweak_ks, sector, buf, sector_size, sectors, 1);
+}
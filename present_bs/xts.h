@@ -0,0 +1,17 @@
+#ifndef PRESENT_BS_XTS_H
+#define PRESENT_BS_XTS_H
+
+#include "present_bs.h"
+
+/*
+ * XEX/XTS style tweakable sector encryption. Every sector gets its own tweak
+ * T = E(tweak_ks, sector number), and block j of the sector is encrypted as
+ * C = E(data_ks, P ^ T * a^j) ^ T * a^j in GF(2^64). sector_size has to be a
+ * non-zero multiple of CRYPTO_IN_SIZE, ciphertext stealing is not supported.
+ */
+void present_bs_xts_encrypt(const present_bs_key_t *data_ks, const present_bs_key_t *tweak_ks,
+	uint64_t sector, uint8_t *buf, size_t sector_size, size_t sectors);
+void present_bs_xts_decrypt(const present_bs_key_t *data_ks, const present_bs_key_t *tweak_ks,
+	uint64_t sector, uint8_t *buf, size_t sector_size, size_t sectors);
+
+#endif
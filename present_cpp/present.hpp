@@ -0,0 +1,305 @@
+#ifndef PRESENT_HPP
+#define PRESENT_HPP
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Header-only bitsliced PRESENT. The cipher is a template over the lane type,
+ * the number of rounds and the key size, so every instance is compiled on its own
+ * with all loops inside a round unrolled and every permutation resolved at compile
+ * time. Nothing here has external linkage, so any number of instances (and the C
+ * engines with their crypto_func) can live in the same program.
+ *
+ * Lane types are the unsigned integers, giving 8 ... 64 blocks per batch, and GCC
+ * vector types such as present::simd<std::uint64_t, 2>::type (SSE, 128 blocks) or
+ * present::simd<std::uint64_t, 4>::type (AVX, 256 blocks).
+ */
+namespace present
+{
+
+// Vector lane types, e.g. simd<std::uint64_t, 4>::type for a 256-bit register
+template <typename E, std::size_t N>
+struct simd
+{
+	typedef E type __attribute__((vector_size(sizeof(E) * N)));
+};
+
+template <typename T>
+struct lane_traits;
+
+template <std::unsigned_integral T>
+struct lane_traits<T>
+{
+	static constexpr std::size_t width = sizeof(T) * 8;
+
+	static constexpr T broadcast(bool bit) { return bit ? T(~T(0)) : T(0); }
+	static constexpr bool get(const T &v, std::size_t l) { return (v >> l) & 1; }
+	static constexpr void set(T &v, std::size_t l) { v |= T(T(1) << l); }
+};
+
+template <typename T>
+	requires requires(T v) { v[0]; } && (!std::is_pointer_v<T>) && (!std::is_array_v<T>)
+struct lane_traits<T>
+{
+	using element = std::remove_cvref_t<decltype(std::declval<T>()[0])>;
+	static constexpr std::size_t element_bits = sizeof(element) * 8;
+	static constexpr std::size_t width = sizeof(T) * 8;
+
+	static T broadcast(bool bit)
+	{
+		T v = {};
+		return v - element(bit);
+	}
+
+	static bool get(const T &v, std::size_t l) { return (v[l / element_bits] >> (l % element_bits)) & 1; }
+	static void set(T &v, std::size_t l) { v[l / element_bits] |= element(1) << (l % element_bits); }
+};
+
+namespace detail
+{
+
+// unroll calls f.template operator()<I>() for I = 0 ... N - 1, with I a constant
+template <std::size_t N, typename F>
+constexpr void unroll(F &&f)
+{
+	[&]<std::size_t... I>(std::index_sequence<I...>) { (f.template operator()<I>(), ...); }(std::make_index_sequence<N>{});
+}
+
+inline constexpr std::array<std::uint8_t, 16> sbox = {
+	0xC, 0x5, 0x6, 0xB, 0x9, 0x0, 0xA, 0xD, 0x3, 0xE, 0xF, 0x8, 0x4, 0x7, 0x1, 0x2,
+};
+
+// pbox[i] is the position bit i of the state is moved to, pbox_inv the way back
+inline constexpr std::array<std::uint8_t, 64> pbox = [] {
+	std::array<std::uint8_t, 64> p{};
+	for (std::size_t i = 0; i < 64; i++)
+	{
+		p[i] = static_cast<std::uint8_t>((i / 4) + (i % 4) * 16);
+	}
+	return p;
+}();
+
+inline constexpr std::array<std::uint8_t, 64> pbox_inv = [] {
+	std::array<std::uint8_t, 64> p{};
+	for (std::size_t i = 0; i < 64; i++)
+	{
+		p[pbox[i]] = static_cast<std::uint8_t>(i);
+	}
+	return p;
+}();
+
+/*
+ * expand computes the round keys of PRESENT-80 or PRESENT-128. The key register is
+ * kept in one 128-bit integer, key[0] being its least significant byte like in the C
+ * engines, and every round key is the upper 64 bits of the register.
+ */
+template <unsigned Rounds, unsigned KeyBits>
+constexpr std::array<std::uint64_t, Rounds + 1> expand(std::span<const std::uint8_t, KeyBits / 8> key)
+{
+	using u128 = unsigned __int128;
+	constexpr u128 mask = KeyBits == 128 ? ~u128(0) : (u128(1) << KeyBits) - 1;
+	std::array<std::uint64_t, Rounds + 1> rk{};
+	u128 k = 0;
+
+	for (std::size_t i = 0; i < KeyBits / 8; i++)
+	{
+		k |= u128(key[i]) << (i * 8);
+	}
+
+	for (unsigned r = 1; r <= Rounds + 1; r++)
+	{
+		rk[r - 1] = static_cast<std::uint64_t>(k >> (KeyBits - 64));
+
+		// rotate left by 61, S-box on the top nibble(s), round counter into the middle
+		k = ((k << 61) | (k >> (KeyBits - 61))) & mask;
+		k = (k & ~(u128(0xF) << (KeyBits - 4))) | (u128(sbox[static_cast<unsigned>(k >> (KeyBits - 4)) & 0xF]) << (KeyBits - 4));
+		if constexpr (KeyBits == 128)
+		{
+			k = (k & ~(u128(0xF) << 120)) | (u128(sbox[static_cast<unsigned>(k >> 120) & 0xF]) << 120);
+			k ^= u128(r) << 62;
+		}
+		else
+		{
+			k ^= u128(r) << 15;
+		}
+	}
+
+	return rk;
+}
+
+} // namespace detail
+
+template <typename Lane, unsigned Rounds = 31, unsigned KeyBits = 80>
+class bitsliced
+{
+	static_assert(KeyBits == 80 || KeyBits == 128, "PRESENT has 80 and 128 bit keys");
+	static_assert(Rounds >= 1 && Rounds <= 31, "the round counter of the key schedule has 5 bits");
+
+	using traits = lane_traits<Lane>;
+	using state = std::array<Lane, 64>;
+
+public:
+	static constexpr std::size_t block_size = 8;
+	static constexpr std::size_t key_size = KeyBits / 8;
+	static constexpr std::size_t lanes = traits::width;
+
+	explicit constexpr bitsliced(std::span<const std::uint8_t, key_size> key)
+		: rk_(detail::expand<Rounds, KeyBits>(key))
+	{
+	}
+
+	/*
+	 * Encrypt or decrypt whole blocks in place. data.size() has to be a multiple of
+	 * block_size, a trailing partial block is left untouched. The last batch may be
+	 * partial, its unused lanes are simply not written back.
+	 */
+	void encrypt(std::span<std::uint8_t> data) const { bytes<false>(data); }
+	void decrypt(std::span<std::uint8_t> data) const { bytes<true>(data); }
+
+	// Same for blocks given as integers, bit i of a value is bit i of the block
+	void encrypt(std::span<std::uint64_t> data) const { words<false>(data); }
+	void decrypt(std::span<std::uint64_t> data) const { words<true>(data); }
+
+private:
+	std::array<std::uint64_t, Rounds + 1> rk_;
+
+	template <bool Decrypt>
+	void bytes(std::span<std::uint8_t> data) const
+	{
+		std::array<std::uint64_t, lanes> v;
+		std::size_t blocks = data.size() / block_size;
+
+		for (std::size_t b = 0; b < blocks; b += lanes)
+		{
+			std::size_t n = blocks - b < lanes ? blocks - b : lanes;
+
+			for (std::size_t l = 0; l < n; l++)
+			{
+				v[l] = 0;
+				for (std::size_t i = 0; i < block_size; i++)
+				{
+					v[l] |= std::uint64_t(data[(b + l) * block_size + i]) << (i * 8);
+				}
+			}
+
+			run<Decrypt>(std::span<std::uint64_t>(v.data(), n));
+
+			for (std::size_t l = 0; l < n; l++)
+			{
+				for (std::size_t i = 0; i < block_size; i++)
+				{
+					data[(b + l) * block_size + i] = static_cast<std::uint8_t>(v[l] >> (i * 8));
+				}
+			}
+		}
+	}
+
+	template <bool Decrypt>
+	void words(std::span<std::uint64_t> data) const
+	{
+		for (std::size_t b = 0; b < data.size(); b += lanes)
+		{
+			run<Decrypt>(data.subspan(b, data.size() - b < lanes ? data.size() - b : lanes));
+		}
+	}
+
+	// run takes up to one batch of blocks through enslice, the cipher and unslice
+	template <bool Decrypt>
+	void run(std::span<std::uint64_t> v) const
+	{
+		state s{};
+
+		for (std::size_t l = 0; l < v.size(); l++)
+		{
+			detail::unroll<64>([&]<std::size_t I>() {
+				if ((v[l] >> I) & 1)
+				{
+					traits::set(s[I], l);
+				}
+			});
+		}
+
+		if constexpr (Decrypt)
+		{
+			add_round_key(s, rk_[Rounds]);
+			for (unsigned r = Rounds; r > 0; r--)
+			{
+				permute<detail::pbox_inv>(s);
+				sbox_inv_layer(s);
+				add_round_key(s, rk_[r - 1]);
+			}
+		}
+		else
+		{
+			for (unsigned r = 0; r < Rounds; r++)
+			{
+				add_round_key(s, rk_[r]);
+				sbox_layer(s);
+				permute<detail::pbox>(s);
+			}
+			add_round_key(s, rk_[Rounds]);
+		}
+
+		for (std::size_t l = 0; l < v.size(); l++)
+		{
+			std::uint64_t x = 0;
+			detail::unroll<64>([&]<std::size_t I>() { x |= std::uint64_t(traits::get(s[I], l)) << I; });
+			v[l] = x;
+		}
+	}
+
+	static void add_round_key(state &s, std::uint64_t rk)
+	{
+		detail::unroll<64>([&]<std::size_t I>() { s[I] ^= traits::broadcast((rk >> I) & 1); });
+	}
+
+	// The same S-box circuits as present_bs, applied to all 16 nibbles
+	static void sbox_layer(state &s)
+	{
+		const Lane inv = traits::broadcast(true);
+
+		detail::unroll<16>([&]<std::size_t I>() {
+			const Lane x0 = s[I * 4 + 0], x1 = s[I * 4 + 1], x2 = s[I * 4 + 2], x3 = s[I * 4 + 3];
+			const Lane c1 = x2 & x3, c2 = x0 & x3, c3 = x1 & x2;
+
+			s[I * 4 + 0] = x0 ^ (x1 & x2) ^ x2 ^ x3;
+			s[I * 4 + 1] = ((x0 & x1) & (x2 ^ x3)) ^ (x3 & x1) ^ x1 ^ (x0 & c1) ^ c1 ^ x3;
+			s[I * 4 + 2] = (x0 & x1) ^ (c2 & x1) ^ (x3 & x1) ^ x2 ^ c2 ^ (c2 & x2) ^ x3 ^ inv;
+			s[I * 4 + 3] = (c3 & x0) ^ ((x3 & x0) & (x1 ^ x2)) ^ x0 ^ x1 ^ c3 ^ x3 ^ inv;
+		});
+	}
+
+	static void sbox_inv_layer(state &s)
+	{
+		const Lane inv = traits::broadcast(true);
+
+		detail::unroll<16>([&]<std::size_t I>() {
+			const Lane x0 = s[I * 4 + 0], x1 = s[I * 4 + 1], x2 = s[I * 4 + 2], x3 = s[I * 4 + 3];
+			const Lane c01 = x0 & x1, c02 = x0 & x2, c13 = x1 & x3;
+
+			s[I * 4 + 0] = x0 ^ x2 ^ c13 ^ inv;
+			s[I * 4 + 1] = x0 ^ x1 ^ x3 ^ c02 ^ (c02 & x1) ^ c13 ^ (c13 & x0) ^ (x2 & x3) ^ (c02 & x3);
+			s[I * 4 + 2] = c01 ^ c02 ^ (x1 & x2) ^ (c01 & x2) ^ x3 ^ (x0 & x3) ^ c13 ^ (c01 & x3) ^ (c02 & x3) ^ inv;
+			s[I * 4 + 3] = x0 ^ x1 ^ c01 ^ x2 ^ (c01 & x2) ^ x3 ^ (c02 & x3);
+		});
+	}
+
+	// permute moves every entry to its table position, a pure renaming once unrolled
+	template <const std::array<std::uint8_t, 64> &P>
+	static void permute(state &s)
+	{
+		state o;
+		detail::unroll<64>([&]<std::size_t I>() { o[P[I]] = s[I]; });
+		s = o;
+	}
+};
+
+} // namespace present
+
+#endif
@@ -0,0 +1,99 @@
+#include "crypto.h"
+#include "present_il.h"
+#include "engine.h"
+#include "util.h"
+
+#if PRESENT_IL_WAYS != 1 && PRESENT_IL_WAYS != 2 && PRESENT_IL_WAYS != 4 && PRESENT_IL_WAYS != 8
+#error "PRESENT_IL_WAYS has to be 1, 2, 4 or 8"
+#endif
+
+/*
+ * sp holds the combined SBox and permutation tables (see sp_init), so a round is
+ * the XOR of eight lookups. The tables are built by a constructor, so they are
+ * complete before main runs and before any thread can call into the engine, and
+ * are only read after that.
+ */
+static uint64_t sp[8][256];
+
+__attribute__((constructor)) static void init_tables(void)
+{
+	sp_init(sp);
+}
+
+static uint64_t round_sp(uint64_t s)
+{
+	return sp[0][s & 0xFF] ^ sp[1][(s >> 8) & 0xFF] ^ sp[2][(s >> 16) & 0xFF] ^ sp[3][(s >> 24) & 0xFF]
+		^ sp[4][(s >> 32) & 0xFF] ^ sp[5][(s >> 40) & 0xFF] ^ sp[6][(s >> 48) & 0xFF] ^ sp[7][s >> 56];
+}
+
+/*
+ * encrypt_group runs PRESENT_IL_WAYS blocks through the rounds side by side. Each
+ * round is a chain of eight dependent lookups per block, but the chains of the
+ * different blocks do not depend on each other, so an out-of-order core can work
+ * on all of them at once. The inner loop has a constant count and is unrolled.
+ */
+static void encrypt_group(uint64_t s[PRESENT_IL_WAYS], const uint64_t rk[32])
+{
+	for (uint8_t r = 0; r < 31; r++)
+	{
+		for (uint8_t w = 0; w < PRESENT_IL_WAYS; w++)
+		{
+			s[w] = round_sp(s[w] ^ rk[r]);
+		}
+	}
+
+	for (uint8_t w = 0; w < PRESENT_IL_WAYS; w++)
+	{
+		s[w] ^= rk[31];
+	}
+}
+
+/**
+ * Encrypt n blocks under one expanded key schedule
+ * @param blocks Input: plaintext blocks, Output: ciphertext blocks
+ * @param n Number of blocks, a last group shorter than PRESENT_IL_WAYS is padded
+ * @param key Cipher key, left untouched
+ */
+void present_il_encrypt(uint8_t *blocks, size_t n, const uint8_t key[CRYPTO_KEY_SIZE])
+{
+	uint64_t rk[32];
+	uint64_t s[PRESENT_IL_WAYS];
+	uint8_t k[CRYPTO_KEY_SIZE];
+	uint8_t i;
+
+	for (i = 0; i < CRYPTO_KEY_SIZE; i++)
+	{
+		k[i] = key[i];
+	}
+
+	for (i = 0; i < 32; i++)
+	{
+		rk[i] = get64(k + 2);
+		update_round_key(k, i + 1);
+	}
+
+	while (n)
+	{
+		size_t m = n < PRESENT_IL_WAYS ? n : PRESENT_IL_WAYS;
+
+		for (uint8_t w = 0; w < PRESENT_IL_WAYS; w++)
+		{
+			s[w] = w < m ? get64(blocks + w * CRYPTO_IN_SIZE) : 0;
+		}
+
+		encrypt_group(s, rk);
+
+		for (uint8_t w = 0; w < m; w++)
+		{
+			put64(blocks + w * CRYPTO_IN_SIZE, s[w]);
+		}
+
+		blocks += m * CRYPTO_IN_SIZE;
+		n -= m;
+	}
+}
+
+void crypto_func(uint8_t pt[CRYPTO_IN_SIZE], uint8_t key[CRYPTO_KEY_SIZE])
+{
+	present_il_encrypt(pt, 1, key);
+}
@@ -0,0 +1,14 @@
+#ifndef PRESENT_IL_H
+#define PRESENT_IL_H
+
+#include <stddef.h>
+#include "crypto.h"
+
+// Independent blocks that go through the rounds interleaved: 1, 2, 4 or 8
+#ifndef PRESENT_IL_WAYS
+#define PRESENT_IL_WAYS 4
+#endif
+
+void present_il_encrypt(uint8_t *blocks, size_t n, const uint8_t key[CRYPTO_KEY_SIZE]);
+
+#endif
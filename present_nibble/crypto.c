@@ -0,0 +1,182 @@
+#include "crypto.h"
+#include "present_nibble.h"
+#include "engine.h"
+
+#if !defined(__SSSE3__)
+#error "present_nibble needs SSSE3 (pshufb)"
+#endif
+
+#include <immintrin.h>
+
+/*
+ * Nibble-sliced PRESENT for x86 hosts with SSSE3 or AVX2. Every block is spread over
+ * one 128-bit lane with one nibble per byte, so the SBox becomes a single pshufb of
+ * the sbox table and no transposition is needed. This pays off for 2 ... 16 blocks,
+ * where the enslice/unslice of present_bs costs more than the cipher. With AVX2 two
+ * blocks share one register, pshufb works on each 128-bit lane on its own.
+ */
+#if defined(__AVX2__)
+typedef __m256i vec_t;
+#define VEC_BLOCKS 2
+#define vec_set1(b) _mm256_set1_epi8((char)(b))
+#define vec_bcast(x) _mm256_broadcastsi128_si256(x)
+#define vec_and _mm256_and_si256
+#define vec_or _mm256_or_si256
+#define vec_xor _mm256_xor_si256
+#define vec_cmpeq _mm256_cmpeq_epi8
+#define vec_shuffle _mm256_shuffle_epi8
+#else
+typedef __m128i vec_t;
+#define VEC_BLOCKS 1
+#define vec_set1(b) _mm_set1_epi8((char)(b))
+#define vec_bcast(x) (x)
+#define vec_and _mm_and_si128
+#define vec_or _mm_or_si128
+#define vec_xor _mm_xor_si128
+#define vec_cmpeq _mm_cmpeq_epi8
+#define vec_shuffle _mm_shuffle_epi8
+#endif
+
+/*
+ * spread turns 8 bytes into 16 nibbles, one per byte: byte 2i gets the lower and
+ * byte 2i + 1 the upper nibble of b[i], so byte k holds bits 4k ... 4k + 3.
+ */
+static __m128i spread(const uint8_t b[CRYPTO_IN_SIZE])
+{
+	const __m128i low = _mm_set1_epi8(0x0F);
+	__m128i x = _mm_loadl_epi64((const __m128i *)b);
+
+	return _mm_unpacklo_epi8(_mm_and_si128(x, low), _mm_and_si128(_mm_srli_epi16(x, 4), low));
+}
+
+// gather is the inverse of spread, it packs pairs of nibbles back into bytes
+static void gather(__m128i x, uint8_t b[CRYPTO_IN_SIZE])
+{
+	__m128i w = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi16(x, 4)), _mm_set1_epi16(0x00FF));
+	_mm_storel_epi64((__m128i *)b, _mm_packus_epi16(w, w));
+}
+
+/*
+ * Shuffle and mask tables of the permutation. Output nibble 4j + m takes bit b from
+ * bit j of input nibble 4m + b. pbox_idx[b] moves input nibble 4m + b to every
+ * output nibble 4j + m, and pbox_bit selects bit j at output nibble 4j + m.
+ */
+static const uint8_t pbox_idx[4][16] = {
+	{ 0, 4, 8, 12, 0, 4, 8, 12, 0, 4, 8, 12, 0, 4, 8, 12 },
+	{ 1, 5, 9, 13, 1, 5, 9, 13, 1, 5, 9, 13, 1, 5, 9, 13 },
+	{ 2, 6, 10, 14, 2, 6, 10, 14, 2, 6, 10, 14, 2, 6, 10, 14 },
+	{ 3, 7, 11, 15, 3, 7, 11, 15, 3, 7, 11, 15, 3, 7, 11, 15 },
+};
+
+static const uint8_t pbox_bit[16] = { 1, 1, 1, 1, 2, 2, 2, 2, 4, 4, 4, 4, 8, 8, 8, 8 };
+
+/*
+ * pbox_layer applies the permutation to all nibbles in x. For every output bit b,
+ * one shuffle brings the source nibbles into place, the compare turns the selected
+ * bit into a full byte, and that byte is cut down to bit b.
+ */
+static vec_t pbox_layer(vec_t x, const vec_t idx[4], vec_t sel)
+{
+	vec_t out = vec_set1(0);
+
+	for (uint8_t b = 0; b < 4; b++)
+	{
+		vec_t s = vec_and(vec_shuffle(x, idx[b]), sel);
+		out = vec_or(out, vec_and(vec_cmpeq(s, sel), vec_set1(1 << b)));
+	}
+
+	return out;
+}
+
+/*
+ * encrypt_group encrypts up to PRESENT_NIBBLE_MAX_BLOCKS blocks. The rounds run over
+ * all registers of the group before moving on, so the independent blocks overlap
+ * in the pipeline.
+ */
+static void encrypt_group(uint8_t *blocks, size_t n, const vec_t rk[32], const vec_t idx[4], vec_t sel, vec_t sb)
+{
+	vec_t state[PRESENT_NIBBLE_MAX_BLOCKS / VEC_BLOCKS];
+	size_t regs = (n + VEC_BLOCKS - 1) / VEC_BLOCKS;
+	size_t i;
+
+	for (i = 0; i < regs; i++)
+	{
+#if VEC_BLOCKS == 2
+		__m128i hi = i * 2 + 1 < n ? spread(blocks + (i * 2 + 1) * CRYPTO_IN_SIZE) : _mm_setzero_si128();
+		state[i] = _mm256_set_m128i(hi, spread(blocks + i * 2 * CRYPTO_IN_SIZE));
+#else
+		state[i] = spread(blocks + i * CRYPTO_IN_SIZE);
+#endif
+	}
+
+	for (uint8_t r = 0; r < 31; r++)
+	{
+		for (i = 0; i < regs; i++)
+		{
+			state[i] = pbox_layer(vec_shuffle(sb, vec_xor(state[i], rk[r])), idx, sel);
+		}
+	}
+
+	for (i = 0; i < regs; i++)
+	{
+		state[i] = vec_xor(state[i], rk[31]);
+
+#if VEC_BLOCKS == 2
+		gather(_mm256_castsi256_si128(state[i]), blocks + i * 2 * CRYPTO_IN_SIZE);
+		if (i * 2 + 1 < n)
+		{
+			gather(_mm256_extracti128_si256(state[i], 1), blocks + (i * 2 + 1) * CRYPTO_IN_SIZE);
+		}
+#else
+		gather(state[i], blocks + i * CRYPTO_IN_SIZE);
+#endif
+	}
+}
+
+/**
+ * Encrypt n blocks under one key
+ * @param blocks Input: plaintext blocks, Output: ciphertext blocks
+ * @param n Number of blocks, best between 2 and PRESENT_NIBBLE_MAX_BLOCKS
+ * @param key Cipher key, left untouched
+ */
+void present_nibble_encrypt(uint8_t *blocks, size_t n, const uint8_t key[CRYPTO_KEY_SIZE])
+{
+	vec_t rk[32];
+	vec_t idx[4];
+	uint8_t k[CRYPTO_KEY_SIZE];
+	uint8_t i;
+
+	for (i = 0; i < CRYPTO_KEY_SIZE; i++)
+	{
+		k[i] = key[i];
+	}
+
+	// bring every round key into nibble form once
+	for (i = 0; i < 32; i++)
+	{
+		rk[i] = vec_bcast(spread(k + 2));
+		update_round_key(k, i + 1);
+	}
+
+	for (i = 0; i < 4; i++)
+	{
+		idx[i] = vec_bcast(_mm_loadu_si128((const __m128i *)pbox_idx[i]));
+	}
+
+	vec_t sel = vec_bcast(_mm_loadu_si128((const __m128i *)pbox_bit));
+	vec_t sb = vec_bcast(_mm_loadu_si128((const __m128i *)sbox));
+
+	while (n)
+	{
+		size_t m = n < PRESENT_NIBBLE_MAX_BLOCKS ? n : PRESENT_NIBBLE_MAX_BLOCKS;
+
+		encrypt_group(blocks, m, rk, idx, sel, sb);
+		blocks += m * CRYPTO_IN_SIZE;
+		n -= m;
+	}
+}
+
+void crypto_func(uint8_t pt[CRYPTO_IN_SIZE], uint8_t key[CRYPTO_KEY_SIZE])
+{
+	present_nibble_encrypt(pt, 1, key);
+}
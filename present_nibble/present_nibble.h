@@ -0,0 +1,12 @@
+#ifndef PRESENT_NIBBLE_H
+#define PRESENT_NIBBLE_H
+
+#include <stddef.h>
+#include "crypto.h"
+
+// Blocks kept in registers at once, larger inputs are processed in groups of this size
+#define PRESENT_NIBBLE_MAX_BLOCKS 16
+
+void present_nibble_encrypt(uint8_t *blocks, size_t n, const uint8_t key[CRYPTO_KEY_SIZE]);
+
+#endif
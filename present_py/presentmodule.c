@@ -0,0 +1,213 @@
+/*
+ * Python bindings for the bulk paths of present_bs.
+ *
+ * encrypt, decrypt and ctr work in place on any writable, C contiguous buffer:
+ * bytearray, memoryview, array.array, NumPy uint8/uint64 arrays, ... The buffer is
+ * used as it is, nothing is copied, and the GIL is released while the cipher runs, so
+ * several Python threads can work on slices of one large array at the same time.
+ *
+ * encrypt_bytes, decrypt_bytes and ctr_bytes take any bytes-like object, including
+ * read-only ones such as bytes, and return the result as a new bytes object. They
+ * cost one copy of the data.
+ *
+ * A uint64 array holds one block per element on little endian hosts, as a block in
+ * normal form is the little endian encoding of the integer.
+ *
+ * Build together with present_bs/crypto.c and the crypto.h of the target, e.g.
+ *   cc -shared -fPIC -O2 $(python3-config --includes) -I../present_bs -I<crypto.h dir> \
+ *      presentmodule.c ../present_bs/crypto.c -o present$(python3-config --extension-suffix)
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "present_bs.h"
+
+/*
+ * get_args parses (key, buffer) or (key, counter, buffer) and expands the key. With
+ * copy set any bytes-like buffer is taken, otherwise it has to be writable. On success
+ * view holds the buffer and has to be released by the caller.
+ */
+static int get_args(PyObject *args, present_bs_key_t *ks, Py_buffer *view, unsigned long long *ctr, int copy)
+{
+	Py_buffer key;
+	int ok;
+
+	if (ctr)
+	{
+		ok = PyArg_ParseTuple(args, copy ? "y*Ky*" : "y*Kw*", &key, ctr, view);
+	}
+	else
+	{
+		ok = PyArg_ParseTuple(args, copy ? "y*y*" : "y*w*", &key, view);
+	}
+
+	if (!ok)
+	{
+		return -1;
+	}
+
+	if (key.len != CRYPTO_KEY_SIZE)
+	{
+		PyErr_Format(PyExc_ValueError, "key must be %d bytes", CRYPTO_KEY_SIZE);
+		PyBuffer_Release(&key);
+		PyBuffer_Release(view);
+		return -1;
+	}
+
+	if (!PyBuffer_IsContiguous(view, 'C'))
+	{
+		PyErr_SetString(PyExc_ValueError, "buffer must be C contiguous");
+		PyBuffer_Release(&key);
+		PyBuffer_Release(view);
+		return -1;
+	}
+
+	present_bs_expand_key(ks, key.buf);
+	PyBuffer_Release(&key);
+
+	return 0;
+}
+
+enum op
+{
+	OP_ENCRYPT,
+	OP_DECRYPT,
+	OP_CTR,
+};
+
+// run is called without the GIL, a partial last batch is handled by present_bs itself
+static void run(const present_bs_key_t *ks, enum op op, unsigned long long ctr, uint8_t *buf, size_t len)
+{
+	switch (op)
+	{
+	case OP_ENCRYPT:
+		present_bs_encrypt_blocks(ks, buf, len / CRYPTO_IN_SIZE);
+		break;
+	case OP_DECRYPT:
+		present_bs_decrypt_blocks(ks, buf, len / CRYPTO_IN_SIZE);
+		break;
+	case OP_CTR:
+		present_bs_ctr_xor(ks, ctr, buf, buf, len);
+		break;
+	}
+}
+
+/*
+ * call runs op on the buffer argument. In place it returns None. With copy set the
+ * argument is left untouched, the result is built in a new bytes object, which is
+ * returned. Only the copy into it needs the GIL.
+ */
+static PyObject *call(PyObject *args, enum op op, int copy)
+{
+	present_bs_key_t ks;
+	Py_buffer view;
+	unsigned long long ctr = 0;
+	PyObject *out = NULL;
+	uint8_t *buf;
+	size_t len;
+
+	if (get_args(args, &ks, &view, op == OP_CTR ? &ctr : NULL, copy))
+	{
+		return NULL;
+	}
+
+	if (op != OP_CTR && view.len % CRYPTO_IN_SIZE)
+	{
+		PyErr_Format(PyExc_ValueError, "buffer length must be a multiple of %d", CRYPTO_IN_SIZE);
+		PyBuffer_Release(&view);
+		return NULL;
+	}
+
+	len = (size_t)view.len;
+
+	if (copy)
+	{
+		out = PyBytes_FromStringAndSize(view.buf, view.len);
+		PyBuffer_Release(&view);
+
+		if (!out)
+		{
+			return NULL;
+		}
+
+		buf = (uint8_t *)PyBytes_AS_STRING(out);
+	}
+	else
+	{
+		buf = view.buf;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	run(&ks, op, ctr, buf, len);
+	Py_END_ALLOW_THREADS
+
+	if (copy)
+	{
+		return out;
+	}
+
+	PyBuffer_Release(&view);
+	Py_RETURN_NONE;
+}
+
+static PyObject *py_encrypt(PyObject *self, PyObject *args)
+{
+	(void)self;
+	return call(args, OP_ENCRYPT, 0);
+}
+
+static PyObject *py_decrypt(PyObject *self, PyObject *args)
+{
+	(void)self;
+	return call(args, OP_DECRYPT, 0);
+}
+
+static PyObject *py_ctr(PyObject *self, PyObject *args)
+{
+	(void)self;
+	return call(args, OP_CTR, 0);
+}
+
+static PyObject *py_encrypt_bytes(PyObject *self, PyObject *args)
+{
+	(void)self;
+	return call(args, OP_ENCRYPT, 1);
+}
+
+static PyObject *py_decrypt_bytes(PyObject *self, PyObject *args)
+{
+	(void)self;
+	return call(args, OP_DECRYPT, 1);
+}
+
+static PyObject *py_ctr_bytes(PyObject *self, PyObject *args)
+{
+	(void)self;
+	return call(args, OP_CTR, 1);
+}
+
+static PyMethodDef present_methods[] = {
+	{ "encrypt", py_encrypt, METH_VARARGS,
+		"encrypt(key, buffer)\n\nECB encrypt buffer in place, its length must be a multiple of 8." },
+	{ "decrypt", py_decrypt, METH_VARARGS,
+		"decrypt(key, buffer)\n\nECB decrypt buffer in place, its length must be a multiple of 8." },
+	{ "ctr", py_ctr, METH_VARARGS,
+		"ctr(key, counter, buffer)\n\nXOR buffer in place with the CTR keystream starting at counter block counter." },
+	{ "encrypt_bytes", py_encrypt_bytes, METH_VARARGS,
+		"encrypt_bytes(key, data) -> bytes\n\nECB encrypt any bytes-like data into a new bytes object." },
+	{ "decrypt_bytes", py_decrypt_bytes, METH_VARARGS,
+		"decrypt_bytes(key, data) -> bytes\n\nECB decrypt any bytes-like data into a new bytes object." },
+	{ "ctr_bytes", py_ctr_bytes, METH_VARARGS,
+		"ctr_bytes(key, counter, data) -> bytes\n\nCTR encrypt or decrypt any bytes-like data into a new bytes object." },
+	{ NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef present_module = {
+	PyModuleDef_HEAD_INIT, "present", "Bitsliced PRESENT-80 bulk operations.", -1, present_methods,
+	NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_present(void)
+{
+	return PyModule_Create(&present_module);
+}
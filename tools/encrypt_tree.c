@@ -0,0 +1,633 @@
+/*
+ * Encrypts (or decrypts with -d) a directory tree into a mirrored tree with a pool
+ * of threads running the bitsliced CTR mode of present_bs. With -r an encrypted tree
+ * is rotated to a new tree key in one pass: the nonces stay, and every chunk goes
+ * through present_bs_ctr_rekey, which XORs the old and the new keystream while sliced.
+ *
+ * Every output file starts with a 32-byte header: the magic "PRSTFIL1", a 64-bit file
+ * nonce, the plaintext length and 8 reserved bytes, all little-endian. The file key is
+ * E(nonce) || E(~nonce)[0..1] under the tree key, so counters restart at 0 in every
+ * file and nonces only have to be distinct: they are a random base plus the walk index.
+ *
+ * Work is planned before any thread starts. Files of at least one chunk are split into
+ * chunks of whole batches, which stay independent because CTR is seekable, while
+ * smaller files are packed into shared units of up to one chunk and the keys of a
+ * unit are derived together in one sliced call. Units are handed out largest first so
+ * big files do not end up as the tail of the run.
+ *
+ * Build with the crypto.h of the host, e.g.
+ *   cc -O2 -pthread -I../present_bs -I<crypto.h dir> encrypt_tree.c ../present_bs/arena.c ../present_bs/crypto.c \
+ *      -o encrypt_tree
+ * Usage: encrypt_tree [-d | -r <new key>] [-j threads] [-c chunk KB] -k <20 hex digits> <src> <dst>
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "present_bs.h"
+#include "util.h"
+
+#define HEADER_SIZE 32
+#define MAGIC "PRSTFIL1"
+#define UNIT_FILES 256 // small files packed into one unit at most
+#define MAX_THREADS 1024
+#define MAX_CHUNK_KB (1024 * 1024) // 1 GB, a chunk is one read into a worker buffer
+#define KEY_FILES (PRESENT_BS_BATCH_SIZE / CRYPTO_IN_SIZE / 2) // file keys derived per sliced call
+
+typedef struct
+{
+	char *path; // relative to the tree roots
+	uint64_t nonce;
+	uint64_t len; // plaintext length
+} file_t;
+
+typedef struct
+{
+	size_t first; // index of the first file, or of the chunked file
+	size_t count; // files in the unit, 0 for a chunk of a large file
+	uint64_t off; // plaintext offset of the chunk
+	uint64_t len; // plaintext bytes in the unit
+} unit_t;
+
+static struct
+{
+	int decrypt;
+	int rekey;
+	unsigned threads;
+	size_t chunk;
+	present_bs_key_t ks;
+	present_bs_key_t new_ks;
+	const char *src;
+	const char *dst;
+	size_t src_len;
+	uint64_t nonce_base;
+
+	file_t *files;
+	size_t file_count, file_cap;
+	unit_t *units;
+	size_t unit_count, unit_cap;
+
+	size_t next_unit;
+	uint64_t bytes;
+	size_t errors;
+} tree;
+
+static void fail(const char *what, const char *path)
+{
+	fprintf(stderr, "%s %s: %s\n", what, path, strerror(errno));
+	__atomic_fetch_add(&tree.errors, 1, __ATOMIC_RELAXED);
+}
+
+// join builds root/rel into buf
+static const char *join(char *buf, const char *root, const char *rel)
+{
+	snprintf(buf, PATH_MAX, "%s%s", root, rel);
+	return buf;
+}
+
+static int read_full(int fd, uint8_t *buf, size_t len, off_t off)
+{
+	while (len)
+	{
+		ssize_t r = pread(fd, buf, len, off);
+		if (r <= 0)
+		{
+			if (r == 0)
+			{
+				errno = EIO;
+			}
+			return -1;
+		}
+		buf += r;
+		len -= (size_t)r;
+		off += r;
+	}
+	return 0;
+}
+
+static int write_full(int fd, const uint8_t *buf, size_t len, off_t off)
+{
+	while (len)
+	{
+		ssize_t r = pwrite(fd, buf, len, off);
+		if (r < 0)
+		{
+			return -1;
+		}
+		buf += r;
+		len -= (size_t)r;
+		off += r;
+	}
+	return 0;
+}
+
+static void put_header(uint8_t h[HEADER_SIZE], const file_t *f)
+{
+	memcpy(h, MAGIC, 8);
+	put64(h + 8, f->nonce);
+	put64(h + 16, f->len);
+	memset(h + 24, 0, 8);
+}
+
+static int get_header(const uint8_t h[HEADER_SIZE], file_t *f, uint64_t payload)
+{
+	if (memcmp(h, MAGIC, 8) || get64(h + 16) != payload)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	f->nonce = get64(h + 8);
+	return 0;
+}
+
+/*
+ * derive_keys expands the file keys of n files under the tree key master into ks,
+ * KEY_FILES per sliced call. Lane 2i carries the nonce and lane 2i + 1 its complement.
+ */
+static void derive_keys(const present_bs_key_t *master, const file_t *const *files, size_t n, present_bs_key_t *ks)
+{
+	uint64_t v[2 * KEY_FILES];
+
+	for (size_t done = 0; done < n; done += KEY_FILES)
+	{
+		size_t m = n - done < KEY_FILES ? n - done : KEY_FILES;
+
+		for (size_t i = 0; i < m; i++)
+		{
+			v[2 * i] = files[done + i]->nonce;
+			v[2 * i + 1] = ~files[done + i]->nonce;
+		}
+		present_bs_encrypt_u64(master, v, 2 * m);
+
+		for (size_t i = 0; i < m; i++)
+		{
+			uint8_t key[CRYPTO_KEY_SIZE];
+			uint8_t hi[8];
+
+			put64(key, v[2 * i]);
+			put64(hi, v[2 * i + 1]);
+			memcpy(key + 8, hi, CRYPTO_KEY_SIZE - 8);
+			present_bs_expand_key(&ks[done + i], key);
+		}
+	}
+}
+
+// in_header tells whether input files start with a header, i.e. they are encrypted
+static int in_header(void)
+{
+	return tree.decrypt || tree.rekey;
+}
+
+/*
+ * crypt_file runs CTR over len bytes of a file starting at byte off with the file key
+ * ks, or moves them from ks to new_ks in rekey mode.
+ */
+static void crypt_file(const present_bs_key_t *ks, const present_bs_key_t *new_ks, uint64_t off, uint8_t *buf, size_t len)
+{
+	if (tree.rekey)
+	{
+		present_bs_ctr_rekey(ks, off / CRYPTO_IN_SIZE, new_ks, off / CRYPTO_IN_SIZE, buf, buf, len);
+	}
+	else
+	{
+		present_bs_ctr_xor(ks, off / CRYPTO_IN_SIZE, buf, buf, len);
+	}
+}
+
+// run_chunk processes one chunk of a large file, whose output was created by plan
+static void run_chunk(const unit_t *u, uint8_t *buf)
+{
+	const file_t *f = &tree.files[u->first];
+	off_t in_off = (off_t)u->off + (in_header() ? HEADER_SIZE : 0);
+	off_t out_off = (off_t)u->off + (tree.decrypt ? 0 : HEADER_SIZE);
+	char path[PATH_MAX];
+	present_bs_key_t ks, new_ks;
+
+	int in = open(join(path, tree.src, f->path), O_RDONLY);
+	if (in < 0)
+	{
+		fail("open", path);
+		return;
+	}
+	if (read_full(in, buf, u->len, in_off))
+	{
+		fail("read", path);
+		close(in);
+		return;
+	}
+	close(in);
+
+	derive_keys(&tree.ks, &f, 1, &ks);
+	if (tree.rekey)
+	{
+		derive_keys(&tree.new_ks, &f, 1, &new_ks);
+	}
+	crypt_file(&ks, &new_ks, u->off, buf, u->len);
+
+	int out = open(join(path, tree.dst, f->path), O_WRONLY);
+	if (out < 0 || write_full(out, buf, u->len, out_off))
+	{
+		fail("write", path);
+	}
+	if (out >= 0)
+	{
+		close(out);
+	}
+}
+
+/*
+ * run_small processes a unit of whole small files, reading all of them before the keys
+ * are derived into ks and new_ks, which have room for UNIT_FILES schedules each.
+ */
+static void run_small(const unit_t *u, uint8_t *buf, present_bs_key_t *ks, present_bs_key_t *new_ks)
+{
+	file_t local[UNIT_FILES];
+	const file_t *files[UNIT_FILES] = { 0 };
+	uint8_t *data[UNIT_FILES];
+	uint8_t header[HEADER_SIZE];
+	char path[PATH_MAX];
+	size_t n = 0;
+
+	for (size_t i = 0; i < u->count; i++)
+	{
+		local[n] = tree.files[u->first + i];
+		data[n] = buf;
+
+		int in = open(join(path, tree.src, local[n].path), O_RDONLY);
+		if (in < 0)
+		{
+			fail("open", path);
+			continue;
+		}
+		int err = in_header() && (read_full(in, header, HEADER_SIZE, 0) || get_header(header, &local[n], local[n].len));
+		if (err || read_full(in, buf, local[n].len, in_header() ? HEADER_SIZE : 0))
+		{
+			fail("read", path);
+			close(in);
+			continue;
+		}
+		close(in);
+
+		files[n] = &local[n];
+		buf += local[n].len;
+		n++;
+	}
+
+	derive_keys(&tree.ks, files, n, ks);
+	if (tree.rekey)
+	{
+		derive_keys(&tree.new_ks, files, n, new_ks);
+	}
+
+	for (size_t i = 0; i < n; i++)
+	{
+		crypt_file(&ks[i], &new_ks[i], 0, data[i], local[i].len);
+
+		int out = open(join(path, tree.dst, local[i].path), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		if (out < 0)
+		{
+			fail("create", path);
+			continue;
+		}
+		put_header(header, &local[i]);
+		if ((!tree.decrypt && write_full(out, header, HEADER_SIZE, 0))
+			|| write_full(out, data[i], local[i].len, tree.decrypt ? 0 : HEADER_SIZE))
+		{
+			fail("write", path);
+		}
+		close(out);
+	}
+}
+
+/*
+ * worker takes its chunk buffer and the key schedules of a small file unit from one
+ * arena on huge pages where available, so the batches the cipher streams through are
+ * cache line aligned and covered by few TLB entries.
+ */
+static void *worker(void *arg)
+{
+	present_bs_arena_t arena;
+	size_t size = tree.chunk + 2 * UNIT_FILES * sizeof(present_bs_key_t) + 3 * PRESENT_BS_ARENA_ALIGN;
+	(void)arg;
+
+	if (present_bs_arena_map(&arena, size, 1))
+	{
+		fail("map", "worker arena");
+		return 0;
+	}
+
+	uint8_t *buf = present_bs_arena_batches(&arena, tree.chunk / PRESENT_BS_BATCH_SIZE);
+	present_bs_key_t *ks = present_bs_arena_keys(&arena, UNIT_FILES);
+	present_bs_key_t *new_ks = present_bs_arena_keys(&arena, UNIT_FILES);
+
+	for (;;)
+	{
+		size_t i = __atomic_fetch_add(&tree.next_unit, 1, __ATOMIC_RELAXED);
+		if (i >= tree.unit_count)
+		{
+			break;
+		}
+
+		const unit_t *u = &tree.units[i];
+		if (u->count)
+		{
+			run_small(u, buf, ks, new_ks);
+		}
+		else
+		{
+			run_chunk(u, buf);
+		}
+		__atomic_fetch_add(&tree.bytes, u->len, __ATOMIC_RELAXED);
+	}
+
+	present_bs_arena_unmap(&arena);
+	return 0;
+}
+
+static unit_t *add_unit(void)
+{
+	if (tree.unit_count == tree.unit_cap)
+	{
+		tree.unit_cap = tree.unit_cap ? 2 * tree.unit_cap : 1024;
+		tree.units = realloc(tree.units, tree.unit_cap * sizeof(unit_t));
+	}
+	return &tree.units[tree.unit_count++];
+}
+
+// visit records regular files and mirrors directories, parents come before their children
+static int visit(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+	char out[PATH_MAX];
+	const char *rel = path + tree.src_len;
+	(void)ftw;
+
+	if (type == FTW_D)
+	{
+		if (mkdir(join(out, tree.dst, rel), 0700) && errno != EEXIST)
+		{
+			fail("mkdir", out);
+		}
+		return 0;
+	}
+	if (type != FTW_F || !S_ISREG(st->st_mode))
+	{
+		return 0;
+	}
+
+	uint64_t len = (uint64_t)st->st_size;
+	if (in_header())
+	{
+		if (len < HEADER_SIZE)
+		{
+			errno = EINVAL;
+			fail("read", path);
+			return 0;
+		}
+		len -= HEADER_SIZE;
+	}
+
+	if (tree.file_count == tree.file_cap)
+	{
+		tree.file_cap = tree.file_cap ? 2 * tree.file_cap : 1024;
+		tree.files = realloc(tree.files, tree.file_cap * sizeof(file_t));
+	}
+	file_t *f = &tree.files[tree.file_count++];
+	f->path = strdup(rel);
+	f->nonce = tree.nonce_base + tree.file_count;
+	f->len = len;
+
+	return 0;
+}
+
+// by_len orders units with the most bytes first
+static int by_len(const void *a, const void *b)
+{
+	const unit_t *x = a, *y = b;
+	return (x->len < y->len) - (x->len > y->len);
+}
+
+/*
+ * plan splits the files into units. Large files get their output created and sized
+ * here, so chunks can be written by any thread in any order; with encrypted input their
+ * nonce is read from the header here as well.
+ */
+static void plan(void)
+{
+	unit_t *small = 0;
+	char path[PATH_MAX];
+
+	for (size_t i = 0; i < tree.file_count; i++)
+	{
+		file_t *f = &tree.files[i];
+
+		if (f->len < tree.chunk)
+		{
+			if (!small || small->count == UNIT_FILES || small->len + f->len > tree.chunk)
+			{
+				small = add_unit();
+				*small = (unit_t){ .first = i };
+			}
+			small->count++;
+			small->len += f->len;
+			continue;
+		}
+
+		uint8_t header[HEADER_SIZE];
+		if (in_header())
+		{
+			int in = open(join(path, tree.src, f->path), O_RDONLY);
+			int err = in < 0 || read_full(in, header, HEADER_SIZE, 0) || get_header(header, f, f->len);
+			if (in >= 0)
+			{
+				close(in);
+			}
+			if (err)
+			{
+				fail("read", path);
+				continue;
+			}
+		}
+
+		int out = open(join(path, tree.dst, f->path), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		put_header(header, f);
+		if (out < 0 || (!tree.decrypt && write_full(out, header, HEADER_SIZE, 0))
+			|| ftruncate(out, (off_t)f->len + (tree.decrypt ? 0 : HEADER_SIZE)))
+		{
+			fail("create", path);
+			if (out >= 0)
+			{
+				close(out);
+			}
+			continue;
+		}
+		close(out);
+
+		for (uint64_t off = 0; off < f->len; off += tree.chunk)
+		{
+			unit_t *u = add_unit();
+			*u = (unit_t){ .first = i, .off = off, .len = f->len - off < tree.chunk ? f->len - off : tree.chunk };
+		}
+		small = 0; // add_unit may have moved the array
+	}
+
+	qsort(tree.units, tree.unit_count, sizeof(unit_t), by_len);
+}
+
+// parse_range parses a decimal number in min ... max, returns -1 for anything else
+static int parse_range(const char *arg, unsigned long min, unsigned long max, unsigned long *out)
+{
+	char *end;
+
+	if (*arg < '0' || *arg > '9')
+	{
+		return -1; // strtoul would accept a sign or leading space
+	}
+
+	errno = 0;
+	*out = strtoul(arg, &end, 10);
+
+	return errno || *end || *out < min || *out > max ? -1 : 0;
+}
+
+static int parse_key(const char *hex, uint8_t key[CRYPTO_KEY_SIZE])
+{
+	if (strlen(hex) != 2 * CRYPTO_KEY_SIZE)
+	{
+		return -1;
+	}
+	for (uint8_t i = 0; i < CRYPTO_KEY_SIZE; i++)
+	{
+		unsigned b;
+		if (sscanf(hex + 2 * i, "%2x", &b) != 1)
+		{
+			return -1;
+		}
+		key[i] = (uint8_t)b;
+	}
+	return 0;
+}
+
+static double now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t key[CRYPTO_KEY_SIZE];
+	uint8_t new_key[CRYPTO_KEY_SIZE] = { 0 };
+	int have_key = 0;
+	int bad = 0;
+	int opt;
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long n;
+
+	tree.threads = cpus < 1 ? 1 : cpus > MAX_THREADS ? MAX_THREADS : (unsigned)cpus;
+	tree.chunk = 1 << 20;
+
+	while ((opt = getopt(argc, argv, "dr:j:c:k:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd':
+			tree.decrypt = 1;
+			break;
+		case 'r':
+			bad |= parse_key(optarg, new_key);
+			tree.rekey = 1;
+			break;
+		case 'j':
+			bad |= parse_range(optarg, 1, MAX_THREADS, &n);
+			tree.threads = (unsigned)n;
+			break;
+		case 'c':
+			bad |= parse_range(optarg, 1, MAX_CHUNK_KB, &n);
+			tree.chunk = (size_t)n << 10;
+			break;
+		case 'k':
+			bad |= parse_key(optarg, key);
+			have_key = 1;
+			break;
+		default:
+			bad = 1;
+			break;
+		}
+	}
+
+	if (bad || !have_key || argc - optind != 2 || (tree.decrypt && tree.rekey))
+	{
+		fprintf(stderr, "usage: %s [-d | -r <new key>] [-j threads] [-c chunk KB] -k <20 hex digits> <src> <dst>\n",
+			argv[0]);
+		return 1;
+	}
+
+	tree.chunk = (tree.chunk + PRESENT_BS_BATCH_SIZE - 1) / PRESENT_BS_BATCH_SIZE * PRESENT_BS_BATCH_SIZE;
+	tree.src = argv[optind];
+	tree.dst = argv[optind + 1];
+	tree.src_len = strlen(tree.src);
+	while (tree.src_len > 1 && tree.src[tree.src_len - 1] == '/')
+	{
+		tree.src_len--; // relative paths keep their leading slash
+	}
+	present_bs_expand_key(&tree.ks, key);
+	present_bs_expand_key(&tree.new_ks, new_key);
+
+	if (getrandom(&tree.nonce_base, sizeof(tree.nonce_base), 0) != sizeof(tree.nonce_base))
+	{
+		perror("getrandom");
+		return 1;
+	}
+
+	double start = now();
+
+	if (nftw(tree.src, visit, 64, FTW_PHYS))
+	{
+		perror(tree.src);
+		return 1;
+	}
+	plan();
+
+	// the workers pull units until none are left, so fewer threads than asked still do all files
+	pthread_t threads[tree.threads];
+	unsigned started = 0;
+	while (started < tree.threads && pthread_create(&threads[started], 0, worker, 0) == 0)
+	{
+		started++;
+	}
+	if (started == 0)
+	{
+		fprintf(stderr, "cannot start worker threads\n");
+		return 1;
+	}
+	for (unsigned i = 0; i < started; i++)
+	{
+		pthread_join(threads[i], 0);
+	}
+	tree.threads = started;
+
+	double t = now() - start;
+
+	printf("%zu files, %zu units, %llu bytes in %.3f s on %u threads: %.1f MB/s\n", tree.file_count, tree.unit_count,
+		(unsigned long long)tree.bytes, t, tree.threads, tree.bytes / t / 1e6);
+	if (tree.errors)
+	{
+		fprintf(stderr, "%zu errors\n", tree.errors);
+	}
+
+	return tree.errors ? 1 : 0;
+}
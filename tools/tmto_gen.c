@@ -0,0 +1,232 @@
+/*
+ * Generates a rainbow table for PRESENT keys that are known except for their low
+ * bits, with one chain per lane of present_bs_tmto_chains and a pool of threads
+ * pulling runs of chains.
+ *
+ * Chain i starts at point i. Endpoints are sorted, chains that merged into the same
+ * endpoint are dropped except for one, and the table is written in the tmto.h file
+ * format, which present_bs_tmto_find searches in a mapped file directly.
+ *
+ * Build with the crypto.h of the host, e.g.
+ *   cc -O2 -pthread -I../present_bs -I<crypto.h dir> tmto_gen.c ../present_bs/tmto.c ../present_bs/crypto.c -o tmto_gen
+ * Usage: tmto_gen -b bits -l length -n chains [-j threads] -k <base key, 20 hex digits>
+ *                 -p <plaintext, 16 hex digits> <table file>
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tmto.h"
+#include "util.h"
+
+#define RUN (16 * BITSLICE_WIDTH) // chains a thread takes at once
+#define MAX_THREADS 1024
+
+static struct
+{
+	present_bs_tmto_t t;
+	present_bs_tmto_entry_t *chains;
+	size_t count;
+	size_t next;
+} gen;
+
+static void *worker(void *arg)
+{
+	(void)arg;
+
+	for (;;)
+	{
+		size_t first = __atomic_fetch_add(&gen.next, RUN, __ATOMIC_RELAXED);
+		if (first >= gen.count)
+		{
+			break;
+		}
+
+		size_t n = gen.count - first < RUN ? gen.count - first : RUN;
+		for (size_t i = 0; i < n; i++)
+		{
+			gen.chains[first + i].start = first + i;
+		}
+		present_bs_tmto_chains(&gen.t, gen.chains + first, n);
+	}
+
+	return 0;
+}
+
+static int by_end(const void *a, const void *b)
+{
+	const present_bs_tmto_entry_t *x = a, *y = b;
+
+	if (x->end != y->end)
+	{
+		return x->end < y->end ? -1 : 1;
+	}
+	return (x->start > y->start) - (x->start < y->start);
+}
+
+static int parse_hex(const char *hex, uint8_t *out, size_t len)
+{
+	if (strlen(hex) != 2 * len)
+	{
+		return -1;
+	}
+	for (size_t i = 0; i < len; i++)
+	{
+		unsigned b;
+		if (sscanf(hex + 2 * i, "%2x", &b) != 1)
+		{
+			return -1;
+		}
+		out[i] = (uint8_t)b;
+	}
+	return 0;
+}
+
+static double now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// parse_range parses a decimal number in min ... max, returns -1 for anything else
+static int parse_range(const char *arg, unsigned long min, unsigned long max, unsigned long *out)
+{
+	char *end;
+
+	if (*arg < '0' || *arg > '9')
+	{
+		return -1; // strtoul would accept a sign or leading space
+	}
+
+	errno = 0;
+	*out = strtoul(arg, &end, 10);
+
+	return errno || *end || *out < min || *out > max ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned threads = cpus < 1 ? 1 : cpus > MAX_THREADS ? MAX_THREADS : (unsigned)cpus;
+	uint8_t key[CRYPTO_KEY_SIZE], pt[CRYPTO_IN_SIZE];
+	unsigned long bits = 0, length = 0, n;
+	int have = 0, bad = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "b:l:n:j:k:p:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'b':
+			bad |= parse_range(optarg, 1, 64, &bits);
+			break;
+		case 'l':
+			bad |= parse_range(optarg, 1, UINT32_MAX, &length);
+			break;
+		case 'n':
+			bad |= parse_range(optarg, 1, SIZE_MAX / sizeof(present_bs_tmto_entry_t), &n);
+			gen.count = (size_t)n;
+			break;
+		case 'j':
+			bad |= parse_range(optarg, 1, MAX_THREADS, &n);
+			threads = (unsigned)n;
+			break;
+		case 'k':
+			bad |= parse_hex(optarg, key, CRYPTO_KEY_SIZE);
+			have |= 1;
+			break;
+		case 'p':
+			bad |= parse_hex(optarg, pt, CRYPTO_IN_SIZE);
+			have |= 2;
+			break;
+		default:
+			bad = 1;
+			break;
+		}
+	}
+
+	if (bad || have != 3 || argc - optind != 1 || length == 0 || gen.count == 0
+		|| present_bs_tmto_init(&gen.t, key, pt, (uint8_t)bits, (uint32_t)length))
+	{
+		fprintf(stderr, "usage: %s -b bits -l length -n chains [-j threads] -k <base key> -p <plaintext> <table>\n",
+			argv[0]);
+		return 1;
+	}
+
+	gen.chains = malloc(gen.count * sizeof(present_bs_tmto_entry_t));
+	if (!gen.chains)
+	{
+		fprintf(stderr, "cannot allocate %zu chains\n", gen.count);
+		return 1;
+	}
+
+	double start = now();
+
+	// the workers pull runs until none are left, so fewer threads than asked still do all chains
+	pthread_t pool[threads];
+	unsigned started = 0;
+	while (started < threads && pthread_create(&pool[started], 0, worker, 0) == 0)
+	{
+		started++;
+	}
+	if (started == 0)
+	{
+		fprintf(stderr, "cannot start worker threads\n");
+		return 1;
+	}
+	for (unsigned i = 0; i < started; i++)
+	{
+		pthread_join(pool[i], 0);
+	}
+	threads = started;
+
+	double t = now() - start;
+
+	qsort(gen.chains, gen.count, sizeof(present_bs_tmto_entry_t), by_end);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < gen.count; i++)
+	{
+		if (kept == 0 || gen.chains[kept - 1].end != gen.chains[i].end)
+		{
+			gen.chains[kept++] = gen.chains[i];
+		}
+	}
+
+	FILE *f = fopen(argv[optind], "wb");
+	uint8_t header[PRESENT_BS_TMTO_HEADER_SIZE];
+	int err = !f;
+
+	present_bs_tmto_write_header(&gen.t, kept, header);
+	err = err || fwrite(header, sizeof(header), 1, f) != 1;
+	for (size_t i = 0; !err && i < kept; i++)
+	{
+		uint8_t e[16];
+		put64(e, gen.chains[i].end);
+		put64(e + 8, gen.chains[i].start);
+		err = fwrite(e, sizeof(e), 1, f) != 1;
+	}
+	if (f && fclose(f))
+	{
+		err = 1;
+	}
+	if (err)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+
+	printf("%zu chains of %lu steps in %.3f s on %u threads: %.0f steps/s, %zu distinct endpoints\n", gen.count,
+		length, t, threads, (double)gen.count * length / t, kept);
+
+	free(gen.chains);
+
+	return 0;
+}